@@ -0,0 +1,53 @@
+// sustained LOG_INFO rate through AsyncLogging from several threads
+#include "AsyncLogging.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+static AsyncLogging *g_asyncLog = nullptr;
+
+static void asyncOutput(const char *msg, size_t len) {
+    g_asyncLog->append(msg, len);
+}
+
+static void asyncFlush() {
+    g_asyncLog->flush();
+}
+
+int main(int argc, char *argv[]) {
+    const int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+    const int linesPerThread = argc > 2 ? atoi(argv[2]) : 1000000;
+    const std::string basename = argc > 3 ? argv[3] : "/tmp/async_logging_bench";
+
+    AsyncLogging log(basename, 256 * 1024 * 1024);
+    g_asyncLog = &log;
+    log.start();
+    Logger::instance().setOutput(asyncOutput);
+    Logger::instance().setFlush(asyncFlush);
+
+    Timestamp start(Timestamp::now());
+    std::vector<std::thread> threads;
+    for(int t = 0; t < numThreads; t++) {
+        threads.emplace_back([t, linesPerThread]() {
+            for(int i = 0; i < linesPerThread; i++) {
+                LOG_INFO("%s:%s:%d => thread=%d line=%d abcdefghijklmnopqrstuvwxyz", __FILENAME__, __FUNCTION__, __LINE__, t, i);
+            }
+        });
+    }
+    for(std::thread &t: threads) {
+        t.join();
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    log.stop();
+
+    long total = static_cast<long>(numThreads) * linesPerThread;
+    printf("threads=%d lines=%ld in %.3fs, %.2f M lines/s, dropped %lu\n",
+            numThreads, total, seconds, total / seconds / 1e6, log.droppedLines());
+    return 0;
+}
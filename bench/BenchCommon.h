@@ -0,0 +1,228 @@
+#pragma once
+
+// shared by the loopback suite (echo_throughput_bench, pingpong_latency_bench, connect_churn_bench):
+// an echo server on its own thread, blocking client helpers, a latency recorder with HdrHistogram-style
+// percentile output, and the JSON report every suite bench prints with --json.
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Logger.h"
+#include "TcpConnection.h"
+#include "TcpServer.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+
+namespace bench {
+
+// removes --flag from argv so the positional arguments keep their places
+inline bool takeFlag(int &argc, char *argv[], const char *flag) {
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], flag) == 0) {
+            for(int j = i; j < argc - 1; j++) {
+                argv[j] = argv[j + 1];
+            }
+            argc--;
+            return true;
+        }
+    }
+    return false;
+}
+
+// TcpServer echo on a thread of its own. closeAfterEcho makes the server shut every connection down
+// after its first echo, so clients see the server-initiated close and keep no TIME_WAIT ports
+class EchoServerThread {
+public:
+    EchoServerThread(uint16_t port, int numThreads, bool closeAfterEcho = false) {
+        thread_ = std::thread([this, port, numThreads, closeAfterEcho]() {
+            EventLoop loop;
+            TcpServer server(&loop, InetAddress(port, "127.0.0.1"), "BenchEcho");
+            server.setThreadNum(numThreads);
+            server.setConnectionCallback([](const TcpConnectionPtr&) {});
+            server.setMessageCallback([closeAfterEcho](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+                conn->send(buf->retrieveAllAsString());
+                if(closeAfterEcho)
+                    conn->shutdown();
+            });
+            server.start();
+            loop_ = &loop;
+            ready_.set_value();
+            loop.loop();
+        });
+        ready_.get_future().wait();
+    }
+
+    ~EchoServerThread() {
+        loop_->quit();
+        thread_.join();
+    }
+
+private:
+    std::promise<void> ready_;
+    std::thread thread_;
+    EventLoop *loop_ = nullptr;
+};
+
+// blocking loopback client socket with TCP_NODELAY, -1 if connect fails
+inline int connectLoopback(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof addr) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline bool writeFull(int fd, const char *data, size_t len) {
+    while(len > 0) {
+        ssize_t n = write(fd, data, len);
+        if(n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+inline bool readFull(int fd, char *data, size_t len) {
+    while(len > 0) {
+        ssize_t n = read(fd, data, len);
+        if(n <= 0)
+            return false;
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// keeps every sample, so percentiles are exact. the distribution is printed the way HdrHistogram does:
+// percentile steps halving the remaining tail (50, 75, 87.5, ...) with 1/(1-p) alongside
+class LatencyRecorder {
+public:
+    void reserve(size_t n) { samples_.reserve(n); }
+    void record(int64_t nanos) { samples_.push_back(nanos); }
+    void merge(const LatencyRecorder &other) { samples_.insert(samples_.end(), other.samples_.begin(), other.samples_.end()); }
+
+    size_t count() const { return samples_.size(); }
+
+    // in nanoseconds, p in [0, 100]
+    int64_t percentile(double p) {
+        if(samples_.empty())
+            return 0;
+        sort();
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples_.size()));
+        return samples_[rank == 0 ? 0 : rank - 1];
+    }
+
+    double mean() const {
+        if(samples_.empty())
+            return 0;
+        double sum = 0;
+        for(int64_t s: samples_) {
+            sum += s;
+        }
+        return sum / samples_.size();
+    }
+
+    void printDistribution(FILE *out) {
+        if(samples_.empty())
+            return;
+        sort();
+        fprintf(out, "%12s %14s %10s %14s\n", "Value(us)", "Percentile", "TotalCount", "1/(1-Percentile)");
+        double p = 0;
+        for(;;) {
+            int64_t value = percentile(p);
+            size_t total = static_cast<size_t>(std::ceil(p / 100.0 * samples_.size()));
+            if(p < 100)
+                fprintf(out, "%12.3f %14.12f %10zu %14.2f\n", value / 1000.0, p / 100, total, 1 / (1 - p / 100));
+            else
+                fprintf(out, "%12.3f %14.12f %10zu\n", value / 1000.0, 1.0, samples_.size());
+            if(p >= 100)
+                break;
+            // one tick per halving until fewer than one sample is left in the tail, then the max
+            double tail = 100 - p;
+            p = tail / 2 * samples_.size() / 100 < 1 ? 100 : p + tail / 2;
+        }
+        fprintf(out, "#[Mean = %.3f, Max = %.3f, Total count = %zu]\n", mean() / 1000.0, samples_.back() / 1000.0, samples_.size());
+    }
+
+private:
+    void sort() {
+        if(sortedCount_ != samples_.size()) {
+            std::sort(samples_.begin(), samples_.end());
+            sortedCount_ = samples_.size();
+        }
+    }
+
+private:
+    std::vector<int64_t> samples_;
+    size_t sortedCount_ = 0;
+};
+
+// one flat JSON object, values are numbers or strings
+class JsonObject {
+public:
+    JsonObject& add(const std::string &key, double value) {
+        char buf[64];
+        snprintf(buf, sizeof buf, "%.6g", value);
+        fields_.emplace_back(key, buf);
+        return *this;
+    }
+    JsonObject& add(const std::string &key, int64_t value) {
+        fields_.emplace_back(key, std::to_string(value));
+        return *this;
+    }
+    JsonObject& add(const std::string &key, int value) {
+        return add(key, static_cast<int64_t>(value));
+    }
+    JsonObject& add(const std::string &key, const std::string &value) {
+        fields_.emplace_back(key, "\"" + value + "\"");
+        return *this;
+    }
+
+    std::string str() const {
+        std::string out = "{";
+        for(size_t i = 0; i < fields_.size(); i++) {
+            out += (i ? ", \"" : "\"") + fields_[i].first + "\": " + fields_[i].second;
+        }
+        return out + "}";
+    }
+
+private:
+    std::vector<std::pair<std::string, std::string>> fields_;
+};
+
+// {"bench": name, "results": [...]} on stdout, one result per line so diffs stay readable
+inline void printJson(const char *name, const std::vector<JsonObject> &results) {
+    printf("{\"bench\": \"%s\", \"results\": [\n", name);
+    for(size_t i = 0; i < results.size(); i++) {
+        printf("  %s%s\n", results[i].str().c_str(), i + 1 < results.size() ? "," : "");
+    }
+    printf("]}\n");
+}
+
+}
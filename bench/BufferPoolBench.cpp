@@ -0,0 +1,75 @@
+// connection buffer memory: RSS per idle connection and allocator time under connection churn.
+// each simulated connection owns the same buffers as a TcpConnection: a Buffer for input, a ChainBuffer for output.
+#include "Buffer.h"
+#include "ChainBuffer.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+
+struct ConnBuffers {
+    Buffer input;
+    ChainBuffer output;
+};
+
+static long rssBytes() {
+    long pages = 0;
+    long resident = 0;
+    FILE *fp = fopen("/proc/self/statm", "r");
+    if(fp) {
+        if(fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        fclose(fp);
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+int main(int argc, char *argv[]) {
+    const int numConns = argc > 1 ? atoi(argv[1]) : 100000;
+    const int churnRounds = argc > 2 ? atoi(argv[2]) : 1000000;
+    const std::string request(200, 'q');
+    const std::string burst(256 * 1024, 'b');
+
+    std::vector<std::unique_ptr<ConnBuffers>> conns;
+    conns.reserve(numConns);
+
+    // idle connections that have exchanged one small request/response
+    long before = rssBytes();
+    for(int i = 0; i < numConns; i++) {
+        conns.emplace_back(new ConnBuffers);
+        conns.back()->input.append(request.data(), request.size());
+        conns.back()->input.retrieveAll();
+    }
+    long idle = rssBytes() - before;
+    printf("idle: %d conns, %.0f B RSS/conn\n", numConns, static_cast<double>(idle) / numConns);
+
+    // a tenth of them see a burst that is fully drained again
+    for(int i = 0; i < numConns; i += 10) {
+        conns[i]->input.append(burst.data(), burst.size());
+        conns[i]->input.retrieveAll();
+        conns[i]->output.append(burst.data(), burst.size());
+        conns[i]->output.retrieveAll();
+    }
+    long afterBurst = rssBytes() - before;
+    printf("after burst: %.0f B RSS/conn\n", static_cast<double>(afterBurst) / numConns);
+    conns.clear();
+
+    // connection churn: create, exchange one message, destroy
+    Timestamp start(Timestamp::now());
+    for(int i = 0; i < churnRounds; i++) {
+        ConnBuffers conn;
+        conn.input.append(request.data(), request.size());
+        conn.output.append(conn.input.peek(), conn.input.readableBytes());
+        conn.input.retrieveAll();
+        conn.output.retrieveAll();
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    printf("churn: %d conns in %.3fs, %.1f ns/conn\n", churnRounds, seconds, seconds * 1e9 / churnRounds);
+
+    return 0;
+}
@@ -0,0 +1,174 @@
+// round-trip latency percentiles with blocking loops versus busy-polling loops (EventLoop::setBusyPollMicros).
+// tcp: a blocking client pings a TcpServer echo over loopback, one message in flight.
+// queue: two loops bounce a functor back and forth through queueInLoop, so the eventfd wakeup is on the path.
+// usage: busy_poll_bench [rounds] [spin micros] [message bytes]
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "InetAddress.h"
+#include "Logger.h"
+#include "TcpConnection.h"
+#include "TcpServer.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+using Clock = std::chrono::steady_clock;
+
+static double nanosSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static void report(const char *name, int spinMicros, std::vector<double> &samples) {
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double p) {
+        return samples[static_cast<size_t>(p * (samples.size() - 1))] / 1000.0;
+    };
+    char mode[32];
+    if(spinMicros > 0)
+        snprintf(mode, sizeof mode, "spin %dus", spinMicros);
+    else
+        snprintf(mode, sizeof mode, "blocking");
+    printf("%-6s %-12s %10.1f %10.1f %10.1f %10.1f\n", name, mode, at(0.5), at(0.99), at(0.999), samples.back() / 1000.0);
+}
+
+static std::vector<double> tcpPingPong(int rounds, int spinMicros, size_t messageBytes, uint16_t port) {
+    EventLoop *serverLoop = nullptr;
+    std::promise<void> ready;
+    std::thread server([&]() {
+        EventLoop loop;
+        loop.setBusyPollMicros(spinMicros);
+        TcpServer server(&loop, InetAddress(port, "127.0.0.1"), "BusyPollBench");
+        server.setThreadNum(1);
+        server.setThreadInitCallback([spinMicros](EventLoop *ioLoop) {
+            ioLoop->setBusyPollMicros(spinMicros);
+        });
+        server.setConnectionCallback([](const TcpConnectionPtr&) {});
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(buf->retrieveAllAsString());
+        });
+        server.start();
+        serverLoop = &loop;
+        ready.set_value();
+        loop.loop();
+    });
+    ready.get_future().wait();
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    if(connect(fd, (sockaddr*)&addr, sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+
+    std::string message(messageBytes, 'x');
+    std::vector<char> reply(messageBytes);
+    std::vector<double> samples;
+    samples.reserve(rounds);
+    const int warmup = rounds / 10;
+    for(int i = 0; i < warmup + rounds; i++) {
+        Clock::time_point start = Clock::now();
+        if(write(fd, message.data(), message.size()) != static_cast<ssize_t>(message.size())) {
+            perror("write");
+            exit(1);
+        }
+        size_t got = 0;
+        while(got < messageBytes) {
+            ssize_t n = read(fd, reply.data() + got, messageBytes - got);
+            if(n <= 0) {
+                perror("read");
+                exit(1);
+            }
+            got += n;
+        }
+        if(i >= warmup)
+            samples.push_back(nanosSince(start));
+    }
+    close(fd);
+
+    serverLoop->quit();
+    server.join();
+    return samples;
+}
+
+struct QueuePingPong {
+    EventLoop *ping;
+    EventLoop *pong;
+    int remaining;
+    Clock::time_point start;
+    std::vector<double> samples;
+    std::promise<void> done;
+
+    void send() {
+        start = Clock::now();
+        pong->queueInLoop([this]() {
+            ping->queueInLoop([this]() { receive(); });
+        });
+    }
+
+    void receive() {
+        samples.push_back(nanosSince(start));
+        if(--remaining > 0)
+            send();
+        else
+            done.set_value();
+    }
+};
+
+static std::vector<double> queuePingPong(int rounds, int spinMicros) {
+    auto spin = [spinMicros](EventLoop *loop) { loop->setBusyPollMicros(spinMicros); };
+    EventLoopThread pingThread(spin, "ping");
+    EventLoopThread pongThread(spin, "pong");
+
+    QueuePingPong state;
+    state.ping = pingThread.startLoop();
+    state.pong = pongThread.startLoop();
+    const int warmup = rounds / 10;
+    state.remaining = warmup + rounds;
+    state.samples.reserve(warmup + rounds);
+    std::future<void> done = state.done.get_future();
+    state.ping->runInLoop([&state]() { state.send(); });
+    done.wait();
+
+    state.samples.erase(state.samples.begin(), state.samples.begin() + warmup);
+    return state.samples;
+}
+
+int main(int argc, char *argv[]) {
+    const int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    const int spinMicros = argc > 2 ? atoi(argv[2]) : 50;
+    const size_t messageBytes = argc > 3 ? atoi(argv[3]) : 64;
+    Logger::setLogLevel(Logger::ERROR);
+
+    printf("%-6s %-12s %10s %10s %10s %10s   (round trip, us)\n", "path", "mode", "p50", "p99", "p999", "max");
+    uint16_t port = 19300;
+    for(int spin: {0, spinMicros}) {
+        std::vector<double> samples = tcpPingPong(rounds, spin, messageBytes, port++);
+        report("tcp", spin, samples);
+    }
+    for(int spin: {0, spinMicros}) {
+        std::vector<double> samples = queuePingPong(rounds, spin);
+        report("queue", spin, samples);
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+// delimiter search throughput per kernel set and buffer size, the match at the very end of the buffer,
+// against the std::search that findCRLF used to be. then a line arriving in mss-sized reads, parsed on
+// every read: findCRLF() rescans from peek() each time, scanCRLF() resumes where the last miss stopped.
+// usage: byte_scan_bench [total megabytes per case]
+#include "Buffer.h"
+#include "ByteScan.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+using Clock = std::chrono::steady_clock;
+
+static size_t g_sink = 0;
+
+// GB/s over repeated searches of text
+template <typename F>
+static double throughput(const std::string &text, size_t totalBytes, F search) {
+    const size_t rounds = std::max<size_t>(1, totalBytes / text.size());
+    const char *begin = text.data();
+    const char *end = begin + text.size();
+    for(size_t i = 0; i < rounds / 10 + 1; i++)
+        g_sink += search(begin, end) - begin;
+
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0; i < rounds; i++)
+        g_sink += search(begin, end) - begin;
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return rounds * text.size() / seconds / 1e9;
+}
+
+static const char* stdSearchCRLF(const char *begin, const char *end) {
+    const char kCRLF[] = "\r\n";
+    return std::search(begin, end, kCRLF, kCRLF + 2);
+}
+
+// a line of lineBytes arriving chunkBytes at a time, searched after every chunk. returns us per line
+static double partialReads(size_t lineBytes, size_t chunkBytes, int lines, bool resumable) {
+    std::string line(lineBytes - 2, 'a');
+    line += "\r\n";
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < lines; i++) {
+        Buffer buf;
+        for(size_t off = 0; off < line.size(); off += chunkBytes) {
+            buf.append(line.data() + off, std::min(chunkBytes, line.size() - off));
+            const char *crlf = resumable ? buf.scanCRLF() : buf.findCRLF();
+            if(crlf) {
+                g_sink += crlf - buf.peek();
+                buf.retrieve(crlf + 2 - buf.peek());
+            }
+        }
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / lines;
+}
+
+int main(int argc, char *argv[]) {
+    const size_t totalBytes = (argc > 1 ? atoi(argv[1]) : 256) * size_t(1024 * 1024);
+    const size_t sizes[] = {64, 512, 4096, 65536};
+    const char kNeedle[] = "\r\n\r\n";
+
+    std::vector<ByteScan::Isa> isas;
+    for(ByteScan::Isa isa: {ByteScan::kScalar, ByteScan::kSse2, ByteScan::kAvx2})
+        if(ByteScan::supported(isa))
+            isas.push_back(isa);
+    const ByteScan::Isa detected = ByteScan::isa();
+
+    printf("GB/s, the match is the last bytes of the buffer. detected kernels: %s\n", ByteScan::isaName(detected));
+    printf("%-10s %-12s %10s %10s %10s %10s\n", "search", "kernels", "64", "512", "4096", "65536");
+    auto row = [&](const char *search, const char *kernels, auto fn) {
+        printf("%-10s %-12s", search, kernels);
+        for(size_t size: sizes)
+            printf(" %10.2f", fn(size));
+        printf("\n");
+    };
+    // lines of 'a' ending in the delimiter; for the needle, scattered "\r\n" pairs make false candidates
+    auto text = [](size_t size, const std::string &tail, bool decoys) {
+        std::string s(size - tail.size(), 'a');
+        for(size_t i = 37; decoys && i + 2 < s.size(); i += 61)
+            s[i] = '\r', s[i + 1] = '\n';
+        return s + tail;
+    };
+
+    row("crlf", "std::search", [&](size_t size) { return throughput(text(size, "\r\n", false), totalBytes, stdSearchCRLF); });
+    for(ByteScan::Isa isa: isas) {
+        ByteScan::setIsa(isa);
+        row("crlf", ByteScan::isaName(isa), [&](size_t size) { return throughput(text(size, "\r\n", false), totalBytes, ByteScan::findCRLF); });
+    }
+    for(ByteScan::Isa isa: isas) {
+        ByteScan::setIsa(isa);
+        row("byte", ByteScan::isaName(isa), [&](size_t size) {
+            return throughput(text(size, "\n", false), totalBytes, [](const char *b, const char *e) { return ByteScan::findByte(b, e, '\n'); });
+        });
+    }
+    row("needle4", "std::search", [&](size_t size) {
+        return throughput(text(size, kNeedle, true), totalBytes, [&](const char *b, const char *e) { return std::search(b, e, kNeedle, kNeedle + 4); });
+    });
+    for(ByteScan::Isa isa: isas) {
+        ByteScan::setIsa(isa);
+        row("needle4", ByteScan::isaName(isa), [&](size_t size) {
+            return throughput(text(size, kNeedle, true), totalBytes, [&](const char *b, const char *e) { return ByteScan::find(b, e, kNeedle, 4); });
+        });
+    }
+    ByteScan::setIsa(detected);
+
+    printf("\none line arriving in 1460 byte reads, searched after every read, us per line\n");
+    printf("%-10s %12s %12s\n", "line", "findCRLF", "scanCRLF");
+    for(size_t lineBytes: {size_t(4096), size_t(65536), size_t(1024 * 1024)}) {
+        const int lines = static_cast<int>(std::max<size_t>(10, totalBytes / 64 / lineBytes));
+        printf("%-10zu %12.2f %12.2f\n", lineBytes, partialReads(lineBytes, 1460, lines, false), partialReads(lineBytes, 1460, lines, true));
+    }
+    return g_sink == 0;
+}
@@ -0,0 +1,133 @@
+// poller bookkeeping per connection: register a channel, enable write interest, drop it again while
+// re-enabling reading (a no-op for reading), then disable and remove it, with many other fds registered.
+// each step runs in its own loop iteration over a batch of channels, so every change reaches the poller.
+// runs on every registered backend, the fd table and the skipped no-op epoll_ctl are what it measures.
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+
+struct Churn {
+    EventLoop *loop;
+    std::vector<int> fds;
+    std::vector<std::unique_ptr<Channel>> channels;
+    long remaining;
+    int phase;
+};
+
+static void makePair(int pair[2]) {
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair) < 0) {
+        perror("socketpair");
+        exit(1);
+    }
+}
+
+static void step(Churn *churn) {
+    switch(churn->phase) {
+    case 0:
+        for(int fd: churn->fds) {
+            churn->channels.emplace_back(new Channel(churn->loop, fd));
+            churn->channels.back()->enableReading();
+        }
+        break;
+    case 1:
+        for(std::unique_ptr<Channel> &channel: churn->channels) {
+            channel->enableWriting();
+        }
+        break;
+    case 2:
+        for(std::unique_ptr<Channel> &channel: churn->channels) {
+            channel->disableWriting();
+            channel->enableReading();
+            if(!churn->loop->hasChannel(channel.get()))
+                abort();
+        }
+        break;
+    case 3:
+        for(std::unique_ptr<Channel> &channel: churn->channels) {
+            channel->disableAll();
+            channel->remove();
+        }
+        churn->channels.clear();
+        churn->remaining -= churn->fds.size();
+        if(churn->remaining <= 0) {
+            churn->loop->quit();
+            return ;
+        }
+        break;
+    }
+    churn->phase = (churn->phase + 1) % 4;
+    churn->loop->queueInLoop([churn]() { step(churn); });
+}
+
+static double run(const std::string &pollerName, int background, int churnFds, long cycles) {
+    EventLoop loop(pollerName);
+
+    // idle connections making the table big
+    std::vector<int> fds;
+    std::vector<std::unique_ptr<Channel>> idle;
+    for(int i = 0; i < background / 2; i++) {
+        int pair[2];
+        makePair(pair);
+        for(int fd: pair) {
+            fds.push_back(fd);
+            idle.emplace_back(new Channel(&loop, fd));
+            idle.back()->enableReading();
+        }
+    }
+
+    Churn churn;
+    churn.loop = &loop;
+    churn.remaining = cycles;
+    churn.phase = 0;
+    for(int i = 0; i < churnFds; i++) {
+        int pair[2];
+        makePair(pair);
+        fds.push_back(pair[1]);
+        churn.fds.push_back(pair[0]);
+    }
+
+    Timestamp start(Timestamp::now());
+    // queued from the loop thread before loop(), so nothing wakes the first poll unless we do
+    loop.queueInLoop([&churn]() { step(&churn); });
+    loop.wakeup();
+    loop.loop();
+    double seconds = timeDifference(Timestamp::now(), start);
+
+    for(std::unique_ptr<Channel> &channel: idle) {
+        channel->disableAll();
+        channel->remove();
+    }
+    for(int fd: fds) {
+        close(fd);
+    }
+    for(int fd: churn.fds) {
+        close(fd);
+    }
+    return seconds * 1e9 / cycles;
+}
+
+int main(int argc, char *argv[]) {
+    const int background = argc > 1 ? atoi(argv[1]) : 10000;
+    const int churnFds = argc > 2 ? atoi(argv[2]) : 1000;
+    const long cycles = argc > 3 ? atol(argv[3]) : 1000000;
+    Logger::setLogLevel(Logger::ERROR);
+
+    printf("background=%d churn fds=%d cycles=%ld\n", background, churnFds, cycles);
+    printf("%-8s %12s %16s\n", "poller", "ns/conn", "max conns/s");
+    for(const std::string &name: Poller::pollerNames()) {
+        double ns = run(name, background, churnFds, cycles);
+        printf("%-8s %12.0f %16.0f\n", name.c_str(), ns, 1e9 / ns);
+    }
+    return 0;
+}
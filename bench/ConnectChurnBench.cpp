@@ -0,0 +1,106 @@
+// full connection lifecycles per second over loopback: connect, one echo, server-side close, client close.
+// unlike connection_rate_bench, which only times accepts against resetting clients, every connection here
+// goes through connectEstablished, a message, shutdown and connectDestroyed. the server closes first so
+// TIME_WAIT piles up on its side and the clients do not run out of ephemeral ports.
+// usage: connect_churn_bench [seconds per point] [client threads] [--json]
+#include "BenchCommon.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+
+using namespace bench;
+
+using Clock = std::chrono::steady_clock;
+
+struct Point {
+    int threads;
+    int clients;
+    double seconds;
+    int64_t connections;
+    int64_t failures;
+    LatencyRecorder lifetimes;
+};
+
+static Point run(int numThreads, int numClients, double seconds, uint16_t port) {
+    EchoServerThread server(port, numThreads, true);
+
+    std::atomic_bool running(true);
+    std::atomic<int64_t> completed(0);
+    std::atomic<int64_t> failed(0);
+    std::vector<LatencyRecorder> recorders(numClients);
+    std::vector<std::thread> clients;
+    for(int i = 0; i < numClients; i++) {
+        clients.emplace_back([&, i]() {
+            char byte = 'x';
+            while(running) {
+                Clock::time_point start = Clock::now();
+                int fd = connectLoopback(port);
+                char reply;
+                // the echo, then the server's FIN
+                bool ok = fd >= 0 && writeFull(fd, &byte, 1) && readFull(fd, &reply, 1) && read(fd, &reply, 1) == 0;
+                if(fd >= 0)
+                    close(fd);
+                if(ok) {
+                    recorders[i].record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+                    ++completed;
+                }
+                else {
+                    ++failed;
+                }
+            }
+        });
+    }
+
+    Clock::time_point start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::microseconds(static_cast<long>(seconds * 1e6)));
+    running = false;
+    for(std::thread &t: clients) {
+        t.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    Point p{numThreads, numClients, elapsed, completed.load(), failed.load(), LatencyRecorder()};
+    for(const LatencyRecorder &r: recorders) {
+        p.lifetimes.merge(r);
+    }
+    return p;
+}
+
+int main(int argc, char *argv[]) {
+    const bool json = takeFlag(argc, argv, "--json");
+    const double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    const int numClients = argc > 2 ? atoi(argv[2]) : 4;
+    const int threadCounts[] = {0, 1, 2, 4};
+    // refused or reset connections would log an ERROR each
+    Logger::setLogLevel(Logger::FATAL);
+
+    if(!json)
+        printf("%-8s %8s %10s %8s %10s %10s %10s\n", "threads", "clients", "conns/s", "failed", "p50 us", "p99 us", "p999 us");
+    std::vector<JsonObject> results;
+    uint16_t port = 19700;
+    for(int numThreads: threadCounts) {
+        Point p = run(numThreads, numClients, seconds, port++);
+        double rate = p.connections / p.seconds;
+        if(!json)
+            printf("%-8d %8d %10.0f %8ld %10.1f %10.1f %10.1f\n", p.threads, p.clients, rate, p.failures,
+                    p.lifetimes.percentile(50) / 1000.0, p.lifetimes.percentile(99) / 1000.0, p.lifetimes.percentile(99.9) / 1000.0);
+        results.push_back(JsonObject()
+                .add("threads", p.threads)
+                .add("clients", p.clients)
+                .add("seconds", p.seconds)
+                .add("connections", p.connections)
+                .add("failures", p.failures)
+                .add("conns_per_s", rate)
+                .add("p50_us", p.lifetimes.percentile(50) / 1000.0)
+                .add("p99_us", p.lifetimes.percentile(99) / 1000.0)
+                .add("p999_us", p.lifetimes.percentile(99.9) / 1000.0));
+    }
+    if(json)
+        printJson("connect_churn", results);
+    return 0;
+}
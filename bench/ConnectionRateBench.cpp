@@ -0,0 +1,101 @@
+// accepted connections per second against a TcpServer, single acceptor versus one SO_REUSEPORT acceptor per io loop.
+// clients connect and reset in a tight loop, the server counts connections that reach connectEstablished.
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Logger.h"
+#include "TcpServer.h"
+#include "Timestamp.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+static std::atomic_long g_accepted(0);
+static std::atomic_bool g_running(false);
+
+static void clientLoop(uint16_t port) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // RST on close keeps the client side free of TIME_WAIT sockets
+    linger lin = {1, 0};
+    while(g_running) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof lin);
+        connect(fd, (sockaddr*)&addr, sizeof addr);
+        close(fd);
+    }
+}
+
+// returns accepts/s, meanBatch gets the acceptors' mean connections per wakeup
+static double run(TcpServer::Option option, int numThreads, int numClients, double seconds, uint16_t port, double *meanBatch) {
+    EventLoop *serverLoop = nullptr;
+    std::atomic_bool ready(false);
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port, "127.0.0.1"), "ConnectionRateBench", option);
+        server.setThreadNum(numThreads);
+        server.setConnectionCallback([](const TcpConnectionPtr &conn) {
+            if(conn->connected())
+                ++g_accepted;
+        });
+        server.start();
+        serverLoop = &loop;
+        ready = true;
+        loop.loop();
+        AcceptStats stats = server.acceptStats();
+        *meanBatch = stats.wakeups ? static_cast<double>(stats.accepted) / stats.wakeups : 0;
+    });
+    while(!ready)
+        usleep(1000);
+    usleep(100 * 1000);
+
+    g_running = true;
+    std::vector<std::thread> clients;
+    for(int i = 0; i < numClients; i++) {
+        clients.emplace_back(clientLoop, port);
+    }
+    usleep(200 * 1000);
+    long before = g_accepted;
+    Timestamp start(Timestamp::now());
+    usleep(static_cast<useconds_t>(seconds * 1e6));
+    long accepted = g_accepted - before;
+    double elapsed = timeDifference(Timestamp::now(), start);
+
+    g_running = false;
+    for(std::thread &t: clients) {
+        t.join();
+    }
+    serverLoop->quit();
+    server.join();
+    return accepted / elapsed;
+}
+
+int main(int argc, char *argv[]) {
+    const double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    const int numClients = argc > 2 ? atoi(argv[2]) : 4;
+    const int threadCounts[] = {1, 2, 4, 8};
+    // every reset connection logs an ERROR otherwise
+    Logger::setLogLevel(Logger::FATAL);
+
+    printf("%-8s %18s %8s %18s %8s\n", "threads", "single accepts/s", "batch", "per-loop accepts/s", "batch");
+    uint16_t port = 19100;
+    for(int numThreads: threadCounts) {
+        double singleBatch = 0, perLoopBatch = 0;
+        double single = run(TcpServer::kNoReusePort, numThreads, numClients, seconds, port++, &singleBatch);
+        double perLoop = run(TcpServer::kReusePortPerLoop, numThreads, numClients, seconds, port++, &perLoopBatch);
+        printf("%-8d %18.0f %8.2f %18.0f %8.2f\n", numThreads, single, singleBatch, perLoop, perLoopBatch);
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+// echo throughput over loopback versus message size and server io thread count.
+// every client connection runs on its own thread and keeps one message in flight, the way muduo's
+// pingpong test does, so MiB/s counts the bytes echoed back to the clients.
+// usage: echo_throughput_bench [seconds per point] [connections] [--json]
+#include "BenchCommon.h"
+#include "Timestamp.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+using namespace bench;
+
+struct Point {
+    int threads;
+    size_t messageBytes;
+    int connections;
+    double seconds;
+    int64_t bytes;
+};
+
+static Point run(int numThreads, size_t messageBytes, int numConnections, double seconds, uint16_t port) {
+    EchoServerThread server(port, numThreads);
+
+    std::atomic_bool running(true);
+    std::atomic<int64_t> echoed(0);
+    std::vector<std::thread> clients;
+    for(int i = 0; i < numConnections; i++) {
+        clients.emplace_back([&]() {
+            int fd = connectLoopback(port);
+            if(fd < 0) {
+                perror("connect");
+                exit(1);
+            }
+            std::string message(messageBytes, 'x');
+            std::vector<char> reply(messageBytes);
+            int64_t bytes = 0;
+            while(running) {
+                if(!writeFull(fd, message.data(), messageBytes) || !readFull(fd, reply.data(), messageBytes)) {
+                    perror("echo");
+                    exit(1);
+                }
+                bytes += messageBytes;
+            }
+            echoed += bytes;
+            close(fd);
+        });
+    }
+
+    Timestamp start(Timestamp::monotonicNow());
+    usleep(static_cast<useconds_t>(seconds * 1e6));
+    running = false;
+    for(std::thread &t: clients) {
+        t.join();
+    }
+    double elapsed = timeDifference(Timestamp::monotonicNow(), start);
+    return Point{numThreads, messageBytes, numConnections, elapsed, echoed.load()};
+}
+
+int main(int argc, char *argv[]) {
+    const bool json = takeFlag(argc, argv, "--json");
+    const double seconds = argc > 1 ? atof(argv[1]) : 1.0;
+    const int numConnections = argc > 2 ? atoi(argv[2]) : 8;
+    const int threadCounts[] = {1, 2, 4};
+    const size_t messageSizes[] = {64, 1024, 16 * 1024, 64 * 1024};
+    Logger::setLogLevel(Logger::ERROR);
+
+    if(!json)
+        printf("%-8s %10s %6s %12s %12s\n", "threads", "msg bytes", "conns", "MiB/s", "msgs/s");
+    std::vector<JsonObject> results;
+    uint16_t port = 19500;
+    for(int numThreads: threadCounts) {
+        for(size_t messageBytes: messageSizes) {
+            Point p = run(numThreads, messageBytes, numConnections, seconds, port++);
+            double mibps = p.bytes / p.seconds / (1 << 20);
+            double msgps = p.bytes / static_cast<double>(p.messageBytes) / p.seconds;
+            if(!json)
+                printf("%-8d %10zu %6d %12.1f %12.0f\n", p.threads, p.messageBytes, p.connections, mibps, msgps);
+            results.push_back(JsonObject()
+                    .add("threads", p.threads)
+                    .add("message_bytes", static_cast<int64_t>(p.messageBytes))
+                    .add("connections", p.connections)
+                    .add("seconds", p.seconds)
+                    .add("bytes", p.bytes)
+                    .add("mib_per_s", mibps)
+                    .add("msgs_per_s", msgps));
+        }
+    }
+    if(json)
+        printJson("echo_throughput", results);
+    return 0;
+}
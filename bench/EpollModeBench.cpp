@@ -0,0 +1,148 @@
+// syscalls made by an echo server in level-triggered versus edge-triggered mode.
+// epoll_ctl, epoll_wait, readv, write and writev are interposed here so the library's calls are counted,
+// the clients use send/recv which stay uncounted, and read slower than they write so the server's output queues up.
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Logger.h"
+#include "TcpServer.h"
+#include "Timestamp.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+static std::atomic_long g_epollCtl(0);
+static std::atomic_long g_epollWait(0);
+static std::atomic_long g_reads(0);
+static std::atomic_long g_writes(0);
+
+extern "C" int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event) {
+    ++g_epollCtl;
+    return static_cast<int>(syscall(SYS_epoll_ctl, epfd, op, fd, event));
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout) {
+    ++g_epollWait;
+    return static_cast<int>(syscall(SYS_epoll_pwait, epfd, events, maxevents, timeout, nullptr, _NSIG / 8));
+}
+
+extern "C" ssize_t readv(int fd, const struct iovec *iov, int iovcnt) {
+    ++g_reads;
+    return syscall(SYS_readv, fd, iov, iovcnt);
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count) {
+    ++g_writes;
+    return syscall(SYS_write, fd, buf, count);
+}
+
+extern "C" ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
+    ++g_writes;
+    return syscall(SYS_writev, fd, iov, iovcnt);
+}
+
+static void runClient(uint16_t port, size_t totalBytes) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int rcvbuf = 16 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+
+    std::thread sender([fd, totalBytes]() {
+        std::vector<char> chunk(16 * 1024, 'x');
+        size_t sent = 0;
+        while(sent < totalBytes) {
+            ssize_t n = send(fd, chunk.data(), std::min(chunk.size(), totalBytes - sent), 0);
+            if(n <= 0)
+                break;
+            sent += n;
+        }
+    });
+    std::vector<char> buf(4096);
+    size_t received = 0;
+    for(int calls = 1; received < totalBytes; calls++) {
+        ssize_t n = recv(fd, buf.data(), buf.size(), 0);
+        if(n <= 0)
+            break;
+        received += n;
+        // a consumer slower than the echo, so the server's output queues up
+        if(calls % 16 == 0)
+            usleep(1000);
+    }
+    sender.join();
+    close(fd);
+}
+
+static void run(const char *mode, bool edgeTriggered, int numConns, size_t bytesPerConn, uint16_t port) {
+    EventLoop *serverLoop = nullptr;
+    std::atomic_bool ready(false);
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port, "127.0.0.1"), "EpollModeBench");
+        server.setEdgeTriggered(edgeTriggered);
+        server.setConnectionCallback([](const TcpConnectionPtr&) {});
+        server.setMessageCallback([](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            conn->send(*buf);
+            buf->retrieveAll();
+        });
+        server.start();
+        serverLoop = &loop;
+        ready = true;
+        loop.loop();
+    });
+    while(!ready)
+        usleep(1000);
+
+    g_epollCtl = 0;
+    g_epollWait = 0;
+    g_reads = 0;
+    g_writes = 0;
+    Timestamp start(Timestamp::now());
+    std::vector<std::thread> clients;
+    for(int i = 0; i < numConns; i++) {
+        clients.emplace_back(runClient, port, bytesPerConn);
+    }
+    for(std::thread &t: clients) {
+        t.join();
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    long epollCtl = g_epollCtl, epollWait = g_epollWait, reads = g_reads, writes = g_writes;
+
+    serverLoop->quit();
+    server.join();
+
+    double mb = static_cast<double>(numConns) * bytesPerConn / (1024 * 1024);
+    printf("%-4s %10ld %10ld %10ld %10ld %12.1f %10.1f\n", mode, epollCtl, epollWait, reads, writes,
+            (epollCtl + epollWait + reads + writes) / mb, mb / seconds);
+}
+
+int main(int argc, char *argv[]) {
+    const int numConns = argc > 1 ? atoi(argv[1]) : 8;
+    const size_t bytesPerConn = (argc > 2 ? atol(argv[2]) : 8) * 1024 * 1024;
+    Logger::setLogLevel(Logger::ERROR);
+
+    printf("%-4s %10s %10s %10s %10s %12s %10s\n", "mode", "epoll_ctl", "epoll_wait", "reads", "writes", "syscalls/MB", "MB/s");
+    run("LT", false, numConns, bytesPerConn, 19200);
+    run("ET", true, numConns, bytesPerConn, 19201);
+    return 0;
+}
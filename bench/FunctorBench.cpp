@@ -0,0 +1,72 @@
+// queueing a typical loop task, a bound member function holding a shared_ptr and two arguments,
+// as std::function versus EventLoop::Functor: construct, move into a queue, invoke, destroy.
+#include "EventLoop.h"
+#include "InlineFunction.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <vector>
+
+
+static long g_allocations = 0;
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void *p = malloc(size);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+class Session {
+public:
+    Session(): total_(0) {}
+    void onData(int id, size_t len) { total_ += id + len; }
+    size_t total() const { return total_; }
+
+private:
+    size_t total_;
+};
+
+template<typename Task>
+static void run(const char *name, int rounds) {
+    std::shared_ptr<Session> session(new Session);
+    std::vector<Task> queue;
+    queue.reserve(64);
+
+    long allocations = g_allocations;
+    Timestamp start(Timestamp::now());
+    for(int i = 0; i < rounds; i++) {
+        queue.emplace_back(std::bind(&Session::onData, session, i, static_cast<size_t>(64)));
+        if(queue.size() == 64) {
+            for(const Task &task: queue) {
+                task();
+            }
+            queue.clear();
+        }
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    allocations = g_allocations - allocations;
+
+    printf("%-20s %.2f allocs/task  %.1f ns/task  (checksum %lu)\n",
+            name, static_cast<double>(allocations) / rounds, seconds * 1e9 / rounds, session->total());
+}
+
+int main(int argc, char *argv[]) {
+    const int rounds = argc > 1 ? atoi(argv[1]) : 10000000;
+    run<std::function<void()>>("std::function", rounds);
+    run<EventLoop::Functor>("EventLoop::Functor", rounds);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// cost of length-prefixed framing per message, encode plus decode in memory, no sockets.
+// string: the header is serialised into a std::string together with a copy of the payload, and each
+// decoded frame is copied out with retrieveAsString. codec: LengthHeaderCodec prepends the header into
+// the payload buffer and hands decoded frames over in place.
+// usage: length_codec_bench [frames]
+#include "Buffer.h"
+#include "LengthHeaderCodec.h"
+#include "Timestamp.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+
+static long g_allocations = 0;
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void *p = malloc(size);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+using Clock = std::chrono::steady_clock;
+
+// frames written to the wire buffer before it is decoded, like a batch arriving in one read
+static const int kBatch = 64;
+
+static size_t g_sink = 0;
+
+static void stringRound(Buffer *wire, const std::string &payload) {
+    for(int i = 0; i < kBatch; i++) {
+        int32_t be = htonl(static_cast<int32_t>(payload.size()));
+        std::string frame(reinterpret_cast<const char*>(&be), sizeof be);
+        frame.append(payload);
+        wire->append(frame.data(), frame.size());
+    }
+    while(wire->readableBytes() >= sizeof(int32_t)) {
+        int32_t be;
+        memcpy(&be, wire->peek(), sizeof be);
+        size_t len = ntohl(be);
+        if(wire->readableBytes() < sizeof be + len)
+            break;
+        wire->retrieve(sizeof be);
+        std::string message = wire->retrieveAsString(len);
+        g_sink += message.size();
+    }
+}
+
+static void codecRound(Buffer *wire, LengthHeaderCodec &codec, const std::string &payload) {
+    for(int i = 0; i < kBatch; i++) {
+        Buffer frame(payload.size());
+        frame.append(payload.data(), payload.size());
+        LengthHeaderCodec::encode(&frame);
+        wire->append(frame.peek(), frame.readableBytes());
+    }
+    codec.onMessage(nullptr, wire, Timestamp());
+}
+
+template <typename F>
+static void measure(const char *name, size_t payloadBytes, int frames, F round) {
+    Buffer wire;
+    for(int i = 0; i < 100; i++)
+        round(&wire);
+
+    const int rounds = frames / kBatch;
+    long allocations = g_allocations;
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < rounds; i++)
+        round(&wire);
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    allocations = g_allocations - allocations;
+    const double perFrame = static_cast<double>(rounds) * kBatch;
+    printf("%-8s %8zu %12.1f %14.2f\n", name, payloadBytes, ns / perFrame, allocations / perFrame);
+}
+
+int main(int argc, char *argv[]) {
+    const int frames = argc > 1 ? atoi(argv[1]) : 1000000;
+    const size_t payloadSizes[] = {16, 256, 4096};
+
+    LengthHeaderCodec codec([](const TcpConnectionPtr&, const char*, size_t len, Timestamp) { g_sink += len; });
+
+    printf("%-8s %8s %12s %14s\n", "framing", "payload", "ns/frame", "mallocs/frame");
+    for(size_t payloadBytes: payloadSizes) {
+        const std::string payload(payloadBytes, 'x');
+        measure("string", payloadBytes, frames, [&](Buffer *wire) { stringRound(wire, payload); });
+        measure("codec", payloadBytes, frames, [&](Buffer *wire) { codecRound(wire, codec, payload); });
+    }
+    return g_sink == 0;
+}
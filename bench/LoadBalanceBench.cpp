@@ -0,0 +1,208 @@
+// tail latency of light requests under a skewed connection mix, per TcpServer loop distribution policy.
+// setup opens connections one by one from distinct 127.0.0.x addresses: every 4th stays open as a heavy
+// connection, the others do one request and close. round robin therefore parks every heavy connection on
+// the same loop, the load-aware policies see the closes and spread them. then the heavy clients keep
+// sending requests that cost the server heavy-micros of cpu each, while probe connections ping with free
+// requests and record round trips.
+// usage: load_balance_bench [seconds] [heavy conns] [heavy micros] [probes]
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "InetAddress.h"
+#include "Logger.h"
+#include "TcpConnection.h"
+#include "TcpServer.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+using Clock = std::chrono::steady_clock;
+
+static const int kNumLoops = 4;
+static const size_t kRequestSize = 8;
+
+// the request carries how long the server should burn the cpu before answering
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+    while(buf->readableBytes() >= kRequestSize) {
+        uint32_t micros;
+        memcpy(&micros, buf->peek(), sizeof micros);
+        if(micros > 0) {
+            Clock::time_point until = Clock::now() + std::chrono::microseconds(ntohl(micros));
+            while(Clock::now() < until) {}
+        }
+        conn->send(buf->retrieveAsString(kRequestSize));
+    }
+}
+
+static int connectFrom(int host, uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof local);
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(0x7f000000 | host);
+    if(bind(fd, (sockaddr*)&local, sizeof local) < 0)
+        perror("bind");
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+static void request(int fd, uint32_t micros) {
+    char req[kRequestSize] = {0};
+    uint32_t net = htonl(micros);
+    memcpy(req, &net, sizeof net);
+    if(write(fd, req, sizeof req) != sizeof req) {
+        perror("write");
+        exit(1);
+    }
+    size_t got = 0;
+    while(got < sizeof req) {
+        ssize_t n = read(fd, req + got, sizeof req - got);
+        if(n <= 0) {
+            perror("read");
+            exit(1);
+        }
+        got += n;
+    }
+}
+
+// connectDestroyed has run for everything else, so the policies see the same counts
+static void waitLive(const std::vector<EventLoop*> &loops, int expected) {
+    for(;;) {
+        int live = 0;
+        for(EventLoop *loop: loops) {
+            live += loop->connectionCount();
+        }
+        if(live == expected)
+            return;
+        usleep(100);
+    }
+}
+
+static void run(const char *name, EventLoopThreadPool::Distribution distribution, double seconds,
+        int numHeavy, int heavyMicros, int numProbes, uint16_t port) {
+    std::vector<EventLoop*> loops;
+    EventLoop *serverLoop = nullptr;
+    std::promise<void> ready;
+    std::thread server([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, InetAddress(port, "127.0.0.1"), "LoadBalanceBench");
+        server.setThreadNum(kNumLoops);
+        server.setLoopDistribution(distribution);
+        std::mutex mutex;
+        server.setThreadInitCallback([&](EventLoop *ioLoop) {
+            std::lock_guard<std::mutex> lock(mutex);
+            loops.push_back(ioLoop);
+        });
+        server.setConnectionCallback([](const TcpConnectionPtr&) {});
+        server.setMessageCallback(onMessage);
+        server.start();
+        serverLoop = &loop;
+        ready.set_value();
+        loop.loop();
+    });
+    ready.get_future().wait();
+
+    std::vector<int> heavyFds;
+    int host = 1;
+    for(int j = 0; heavyFds.size() < static_cast<size_t>(numHeavy); j++) {
+        int fd = connectFrom(host++, port);
+        request(fd, 0);
+        if(j % kNumLoops == 0) {
+            heavyFds.push_back(fd);
+        }
+        else {
+            close(fd);
+            waitLive(loops, static_cast<int>(heavyFds.size()));
+        }
+    }
+    waitLive(loops, numHeavy);
+    std::string spread;
+    for(EventLoop *loop: loops) {
+        spread += (spread.empty() ? "" : "/") + std::to_string(loop->connectionCount());
+    }
+
+    std::atomic_bool running(true);
+    std::vector<std::thread> heavyClients;
+    for(int fd: heavyFds) {
+        heavyClients.emplace_back([fd, heavyMicros, &running]() {
+            while(running) {
+                request(fd, heavyMicros);
+                usleep(2000);
+            }
+        });
+    }
+
+    std::vector<int> probeFds;
+    for(int i = 0; i < numProbes; i++) {
+        probeFds.push_back(connectFrom(host++, port));
+    }
+    std::vector<double> samples;
+    Clock::time_point end = Clock::now() + std::chrono::microseconds(static_cast<long>(seconds * 1e6));
+    for(size_t i = 0; Clock::now() < end; i++) {
+        Clock::time_point start = Clock::now();
+        request(probeFds[i % probeFds.size()], 0);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    running = false;
+    for(std::thread &t: heavyClients) {
+        t.join();
+    }
+    for(int fd: heavyFds) {
+        close(fd);
+    }
+    for(int fd: probeFds) {
+        close(fd);
+    }
+    waitLive(loops, 0);
+    serverLoop->quit();
+    server.join();
+
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double p) { return samples[static_cast<size_t>(p * (samples.size() - 1))]; };
+    printf("%-12s %-12s %9zu %9.1f %9.1f %9.1f %9.1f\n", name, spread.c_str(), samples.size(), at(0.5), at(0.99), at(0.999), samples.back());
+}
+
+int main(int argc, char *argv[]) {
+    const double seconds = argc > 1 ? atof(argv[1]) : 2.0;
+    const int numHeavy = argc > 2 ? atoi(argv[2]) : 8;
+    const int heavyMicros = argc > 3 ? atoi(argv[3]) : 100;
+    const int numProbes = argc > 4 ? atoi(argv[4]) : 16;
+    Logger::setLogLevel(Logger::ERROR);
+
+    printf("%-12s %-12s %9s %9s %9s %9s %9s   (probe round trip, us)\n", "policy", "heavy/loop", "probes", "p50", "p99", "p999", "max");
+    uint16_t port = 19400;
+    run("round-robin", EventLoopThreadPool::kRoundRobin, seconds, numHeavy, heavyMicros, numProbes, port++);
+    run("least-conns", EventLoopThreadPool::kLeastConnections, seconds, numHeavy, heavyMicros, numProbes, port++);
+    run("p2c", EventLoopThreadPool::kPowerOfTwoChoices, seconds, numHeavy, heavyMicros, numProbes, port++);
+    run("peer-hash", EventLoopThreadPool::kHashByPeer, seconds, numHeavy, heavyMicros, numProbes, port++);
+    return 0;
+}
@@ -0,0 +1,52 @@
+// cost of a filtered-out LOG_DEBUG versus an enabled line through each front end, output discarded
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+
+static size_t g_bytes = 0;
+
+static void discardOutput(const char *msg, size_t len) {
+    (void)msg;
+    g_bytes += len;
+}
+
+static void report(const char *name, int iterations, Timestamp start) {
+    double seconds = timeDifference(Timestamp::now(), start);
+    printf("%-22s %8.1f ns/call\n", name, seconds * 1e9 / iterations);
+}
+
+int main(int argc, char *argv[]) {
+    const int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+    Logger::instance().setOutput(discardOutput);
+    Logger::setLogLevel(Logger::INFO);
+
+    Timestamp start(Timestamp::now());
+    for(int i = 0; i < iterations; i++) {
+        LOG_DEBUG("%s:%s:%d => fd=%d events=%d", __FILENAME__, __FUNCTION__, __LINE__, i, i & 7);
+    }
+    report("LOG_DEBUG (disabled)", iterations, start);
+
+    start = Timestamp::now();
+    for(int i = 0; i < iterations; i++) {
+        LOG_STREAM(DEBUG) << "fd=" << i << " events=" << (i & 7);
+    }
+    report("LOG_STREAM (disabled)", iterations, start);
+
+    start = Timestamp::now();
+    for(int i = 0; i < iterations; i++) {
+        LOG_INFO("%s:%s:%d => fd=%d events=%d", __FILENAME__, __FUNCTION__, __LINE__, i, i & 7);
+    }
+    report("LOG_INFO", iterations, start);
+
+    start = Timestamp::now();
+    for(int i = 0; i < iterations; i++) {
+        LOG_STREAM(INFO) << "fd=" << i << " events=" << (i & 7);
+    }
+    report("LOG_STREAM (enabled)", iterations, start);
+
+    printf("%zu bytes formatted\n", g_bytes);
+    return 0;
+}
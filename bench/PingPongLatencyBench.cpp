@@ -0,0 +1,74 @@
+// round-trip latency of one echo connection over loopback, one message in flight, with the full
+// HdrHistogram-style percentile distribution per message size.
+// usage: pingpong_latency_bench [rounds] [server io threads] [--json]
+#include "BenchCommon.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+using namespace bench;
+
+using Clock = std::chrono::steady_clock;
+
+static LatencyRecorder run(int rounds, int numThreads, size_t messageBytes, uint16_t port) {
+    EchoServerThread server(port, numThreads);
+    int fd = connectLoopback(port);
+    if(fd < 0) {
+        perror("connect");
+        exit(1);
+    }
+
+    std::string message(messageBytes, 'x');
+    std::vector<char> reply(messageBytes);
+    LatencyRecorder recorder;
+    recorder.reserve(rounds);
+    const int warmup = rounds / 10;
+    for(int i = 0; i < warmup + rounds; i++) {
+        Clock::time_point start = Clock::now();
+        if(!writeFull(fd, message.data(), messageBytes) || !readFull(fd, reply.data(), messageBytes)) {
+            perror("echo");
+            exit(1);
+        }
+        if(i >= warmup)
+            recorder.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+    close(fd);
+    return recorder;
+}
+
+int main(int argc, char *argv[]) {
+    const bool json = takeFlag(argc, argv, "--json");
+    const int rounds = argc > 1 ? atoi(argv[1]) : 50000;
+    const int numThreads = argc > 2 ? atoi(argv[2]) : 1;
+    const size_t messageSizes[] = {64, 1024, 16 * 1024};
+    Logger::setLogLevel(Logger::ERROR);
+
+    std::vector<JsonObject> results;
+    uint16_t port = 19600;
+    for(size_t messageBytes: messageSizes) {
+        LatencyRecorder recorder = run(rounds, numThreads, messageBytes, port++);
+        if(!json) {
+            printf("message %zu bytes, %d io threads\n", messageBytes, numThreads);
+            recorder.printDistribution(stdout);
+            printf("\n");
+        }
+        results.push_back(JsonObject()
+                .add("message_bytes", static_cast<int64_t>(messageBytes))
+                .add("threads", numThreads)
+                .add("count", static_cast<int64_t>(recorder.count()))
+                .add("mean_us", recorder.mean() / 1000)
+                .add("p50_us", recorder.percentile(50) / 1000.0)
+                .add("p90_us", recorder.percentile(90) / 1000.0)
+                .add("p99_us", recorder.percentile(99) / 1000.0)
+                .add("p999_us", recorder.percentile(99.9) / 1000.0)
+                .add("p9999_us", recorder.percentile(99.99) / 1000.0)
+                .add("max_us", recorder.percentile(100) / 1000.0));
+    }
+    if(json)
+        printJson("pingpong_latency", results);
+    return 0;
+}
@@ -0,0 +1,103 @@
+// where EventLoopThreadPool loops run under each CpuPlacement policy, and where their connection buffers land.
+// every loop fills Buffers from its own BufferPool, then move_pages reports the node of each page; pages off the
+// node the loop is running on are what remote (cross-node) accesses would hit. on a single-node machine every
+// page is local whatever the policy, the numbers only become interesting on a multi-socket box.
+// usage: placement_bench [loops] [buffers per loop] [cpu list]
+#include "Buffer.h"
+#include "CpuPlacement.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+
+struct LoopReport {
+    unsigned cpu = 0;
+    unsigned node = 0;
+    int allowedCpus = 0;
+    long pages = 0;
+    long remotePages = 0;
+    double fillMiBps = 0;
+};
+
+static LoopReport fillBuffers(int numBuffers) {
+    LoopReport report;
+    cpu_set_t set;
+    if(sched_getaffinity(0, sizeof set, &set) == 0)
+        report.allowedCpus = CPU_COUNT(&set);
+
+    const size_t bufferBytes = 64 * 1024;
+    std::vector<char> chunk(bufferBytes, 'x');
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    Timestamp start(Timestamp::now());
+    for(int i = 0; i < numBuffers; i++) {
+        buffers.emplace_back(new Buffer);
+        buffers.back()->append(chunk.data(), chunk.size());
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    report.fillMiBps = seconds > 0 ? numBuffers * bufferBytes / seconds / (1 << 20) : 0;
+
+    syscall(SYS_getcpu, &report.cpu, &report.node, nullptr);
+
+    const long pageSize = sysconf(_SC_PAGESIZE);
+    std::vector<void*> pages;
+    for(const std::unique_ptr<Buffer> &buf: buffers) {
+        uintptr_t first = reinterpret_cast<uintptr_t>(buf->peek()) & ~(pageSize - 1);
+        for(uintptr_t page = first; page < reinterpret_cast<uintptr_t>(buf->peek()) + buf->readableBytes(); page += pageSize) {
+            pages.push_back(reinterpret_cast<void*>(page));
+        }
+    }
+    std::vector<int> status(pages.size(), -1);
+    // with no target nodes move_pages only reports where each page is
+    if(syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) == 0) {
+        for(int node: status) {
+            if(node < 0)
+                continue;
+            report.pages++;
+            if(static_cast<unsigned>(node) != report.node)
+                report.remotePages++;
+        }
+    }
+    return report;
+}
+
+static void run(const char *name, const CpuPlacement &placement, int numLoops, int numBuffers) {
+    EventLoop baseLoop;
+    EventLoopThreadPool pool(&baseLoop, name);
+    pool.setThreadNum(numLoops);
+    pool.setPlacement(placement);
+    pool.start();
+
+    std::vector<EventLoop*> loops = pool.getAllLoops();
+    for(size_t i = 0; i < loops.size(); i++) {
+        std::promise<LoopReport> promise;
+        loops[i]->runInLoop([&promise, numBuffers]() { promise.set_value(fillBuffers(numBuffers)); });
+        LoopReport report = promise.get_future().get();
+        printf("%-10s %4zu %4u %5u %8d %8ld %7.2f%% %10.0f\n", name, i, report.cpu, report.node, report.allowedCpus,
+                report.pages, report.pages ? 100.0 * report.remotePages / report.pages : 0.0, report.fillMiBps);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const int numLoops = argc > 1 ? atoi(argv[1]) : 4;
+    const int numBuffers = argc > 2 ? atoi(argv[2]) : 256;
+    const std::string cpus = argc > 3 ? argv[3] : "0";
+    Logger::setLogLevel(Logger::ERROR);
+
+    printf("%-10s %4s %4s %5s %8s %8s %8s %10s\n", "policy", "loop", "cpu", "node", "allowed", "pages", "remote", "fill MiB/s");
+    run("none", CpuPlacement(), numLoops, numBuffers);
+    run("cpulist", CpuPlacement::cpuList(cpus), numLoops, numBuffers);
+    run("cores", CpuPlacement::physicalCores(), numLoops, numBuffers);
+    run("numa", CpuPlacement::numaNodes(), numLoops, numBuffers);
+    return 0;
+}
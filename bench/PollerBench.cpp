@@ -0,0 +1,102 @@
+// the same workload on every registered Poller backend: a ring of socketpairs with tokens passed fd to fd,
+// so every fd is hot. with churn on, each hop also enables and disables write interest like a reply that
+// could not be written at once, which is the epoll_ctl traffic poll(2) avoids.
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+
+struct Ring {
+    EventLoop *loop;
+    bool churn;
+    long remaining;
+    // a token read from readFds[i] is written to writeFds[(i + 1) % n]
+    std::vector<int> readFds;
+    std::vector<int> writeFds;
+    std::vector<std::unique_ptr<Channel>> channels;
+};
+
+static void passToken(Ring *ring, size_t i) {
+    char token = 0;
+    write(ring->writeFds[(i + 1) % ring->writeFds.size()], &token, 1);
+    if(--ring->remaining == 0)
+        ring->loop->quit();
+}
+
+static void onReadable(Ring *ring, size_t i) {
+    char token;
+    if(read(ring->readFds[i], &token, 1) != 1)
+        return;
+    if(ring->churn)
+        ring->channels[i]->enableWriting();
+    else
+        passToken(ring, i);
+}
+
+static void onWritable(Ring *ring, size_t i) {
+    ring->channels[i]->disableWriting();
+    passToken(ring, i);
+}
+
+static double run(const std::string &pollerName, bool churn, int numFds, int numTokens, long hops) {
+    EventLoop loop(pollerName);
+    Ring ring;
+    ring.loop = &loop;
+    ring.churn = churn;
+    ring.remaining = hops;
+    for(int i = 0; i < numFds; i++) {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds);
+        ring.readFds.push_back(fds[0]);
+        ring.writeFds.push_back(fds[1]);
+    }
+    for(int i = 0; i < numFds; i++) {
+        Channel *channel = new Channel(&loop, ring.readFds[i]);
+        channel->setReadCallback([&ring, i](Timestamp) { onReadable(&ring, i); });
+        channel->setWriteCallback([&ring, i]() { onWritable(&ring, i); });
+        channel->enableReading();
+        ring.channels.emplace_back(channel);
+    }
+    for(int i = 0; i < numTokens; i++) {
+        char token = 0;
+        write(ring.writeFds[(i * numFds / numTokens) % numFds], &token, 1);
+    }
+
+    Timestamp start(Timestamp::now());
+    loop.loop();
+    double seconds = timeDifference(Timestamp::now(), start);
+
+    for(int i = 0; i < numFds; i++) {
+        ring.channels[i]->disableAll();
+        ring.channels[i]->remove();
+        close(ring.readFds[i]);
+        close(ring.writeFds[i]);
+    }
+    return seconds * 1e9 / hops;
+}
+
+int main(int argc, char *argv[]) {
+    const int numFds = argc > 1 ? atoi(argv[1]) : 256;
+    const int numTokens = argc > 2 ? atoi(argv[2]) : 64;
+    const long hops = argc > 3 ? atol(argv[3]) : 1000000;
+    Logger::setLogLevel(Logger::ERROR);
+
+    printf("fds=%d tokens=%d hops=%ld\n", numFds, numTokens, hops);
+    printf("%-8s %14s %14s\n", "poller", "ns/hop", "ns/hop churn");
+    for(const std::string &name: Poller::pollerNames()) {
+        double plain = run(name, false, numFds, numTokens, hops);
+        double churn = run(name, true, numFds, numTokens, hops);
+        printf("%-8s %14.0f %14.0f\n", name.c_str(), plain, churn);
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+// cross-thread EventLoop::queueInLoop throughput with 1 to 64 producer threads
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Timestamp.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+int main(int argc, char *argv[]) {
+    const int totalTasks = argc > 1 ? atoi(argv[1]) : 1000000;
+
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startLoop();
+
+    for(int producers = 1; producers <= 64; producers *= 2) {
+        const int perProducer = totalTasks / producers;
+        const long expected = static_cast<long>(perProducer) * producers;
+        std::atomic_long executed(0);
+        std::atomic_bool go(false);
+
+        std::vector<std::thread> threads;
+        for(int i = 0; i < producers; i++) {
+            threads.emplace_back([&]() {
+                while(!go) {
+                    std::this_thread::yield();
+                }
+                for(int n = 0; n < perProducer; n++) {
+                    loop->queueInLoop([&executed]() { executed.fetch_add(1, std::memory_order_relaxed); });
+                }
+            });
+        }
+
+        Timestamp start(Timestamp::now());
+        go = true;
+        for(std::thread &t: threads) {
+            t.join();
+        }
+        double produced = timeDifference(Timestamp::now(), start);
+        while(executed.load() < expected) {
+            usleep(100);
+        }
+        double seconds = timeDifference(Timestamp::now(), start);
+
+        printf("producers=%-3d tasks=%ld  enqueue %.2f Mops/s  end-to-end %.2f Mops/s\n",
+                producers, expected, expected / produced / 1e6, expected / seconds / 1e6);
+    }
+    return 0;
+}
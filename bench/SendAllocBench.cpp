@@ -0,0 +1,136 @@
+// heap allocations per message when a non-io thread sends on a TcpConnection,
+// for each send overload. the connection sits on a socketpair drained by a reader thread.
+// flood sends back to back, paced lets the io loop run each send before the next one, like a reply
+// per request. the queue node is reused once the loop has run it, so only a flood outrunning the loop
+// by more than EventLoop's free node cap allocates one.
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "TcpConnection.h"
+#include "Timestamp.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+
+static thread_local bool t_counting = false;
+static thread_local long t_allocations = 0;
+
+void* operator new(size_t size) {
+    if(t_counting)
+        t_allocations++;
+    void *p = malloc(size);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+static const int kMessages = 100000;
+static const size_t kMessageSize = 1000;
+
+// waits until the io loop has run everything queued so far
+static void drainLoop(EventLoop *loop) {
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    loop->queueInLoop([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        done = true;
+        cond.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&]() { return done; });
+}
+
+// sendOne counts only its own send call, payload construction is excluded
+static void report(const char *name, bool paced, EventLoop *loop, const std::function<void()> &sendOne) {
+    Timestamp start(Timestamp::now());
+    t_allocations = 0;
+    for(int i = 0; i < kMessages; i++) {
+        sendOne();
+        if(paced)
+            drainLoop(loop);
+    }
+    long allocations = t_allocations;
+    drainLoop(loop);
+    double seconds = timeDifference(Timestamp::now(), start);
+    printf("%-28s %-6s %.2f allocs/msg  %.0f ns/msg\n", name, paced ? "paced" : "flood",
+            static_cast<double>(allocations) / kMessages, seconds * 1e9 / kMessages);
+}
+
+int main() {
+    EventLoopThread ioThread;
+    EventLoop *ioLoop = ioThread.startLoop();
+
+    int fds[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+        return 1;
+
+    std::atomic_bool stop(false);
+    std::thread reader([&]() {
+        char buf[65536];
+        while(!stop) {
+            if(read(fds[1], buf, sizeof buf) <= 0)
+                usleep(100);
+        }
+    });
+
+    TcpConnectionPtr conn(new TcpConnection(ioLoop, "bench", fds[0], InetAddress(), InetAddress()));
+    conn->setConnectionCallback([](const TcpConnectionPtr&) {});
+    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    drainLoop(ioLoop);
+
+    const std::string payload(kMessageSize, 'x');
+    std::shared_ptr<const std::string> shared(new std::string(payload));
+
+    for(bool paced: {false, true}) {
+        report("send(const std::string&)", paced, ioLoop, [&]() {
+            t_counting = true;
+            conn->send(payload);
+            t_counting = false;
+        });
+        report("send(std::string&&)", paced, ioLoop, [&]() {
+            std::string msg(payload);
+            t_counting = true;
+            conn->send(std::move(msg));
+            t_counting = false;
+        });
+        report("send(Buffer&&)", paced, ioLoop, [&]() {
+            Buffer buf;
+            buf.append(payload.data(), payload.size());
+            t_counting = true;
+            conn->send(std::move(buf));
+            t_counting = false;
+        });
+        report("send(shared_ptr<string>)", paced, ioLoop, [&]() {
+            t_counting = true;
+            conn->send(shared);
+            t_counting = false;
+        });
+    }
+
+    ioLoop->runInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    drainLoop(ioLoop);
+    stop = true;
+    reader.join();
+    close(fds[1]);
+    return 0;
+}
@@ -0,0 +1,63 @@
+// cost of reading the clocks and formatting log timestamps, uncached localtime formatting as the reference
+#include "EventLoop.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+
+static volatile int64_t g_sink = 0;
+
+static void report(const char *name, int iterations, Timestamp start) {
+    double seconds = timeDifference(Timestamp::monotonicNow(), start);
+    printf("%-28s %8.1f ns/call\n", name, seconds * 1e9 / iterations);
+}
+
+int main(int argc, char *argv[]) {
+    const int iterations = argc > 1 ? atoi(argv[1]) : 1000000;
+    char buf[64];
+
+    Timestamp start(Timestamp::monotonicNow());
+    for(int i = 0; i < iterations; i++) {
+        g_sink += Timestamp::now().microSecondsSinceEpoch();
+    }
+    report("Timestamp::now", iterations, start);
+
+    start = Timestamp::monotonicNow();
+    for(int i = 0; i < iterations; i++) {
+        g_sink += Timestamp::monotonicNow().microSecondsSinceEpoch();
+    }
+    report("Timestamp::monotonicNow", iterations, start);
+
+    EventLoop loop;
+    start = Timestamp::monotonicNow();
+    for(int i = 0; i < iterations; i++) {
+        g_sink += loop.cachedNow().microSecondsSinceEpoch();
+    }
+    report("EventLoop::cachedNow", iterations, start);
+
+    // what every log line paid before: localtime and a full calendar format
+    start = Timestamp::monotonicNow();
+    for(int i = 0; i < iterations; i++) {
+        time_t seconds = static_cast<time_t>(Timestamp::now().microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond);
+        tm *tm_time = localtime(&seconds);
+        g_sink += snprintf(buf, sizeof buf, "%4d/%02d/%02d %02d:%02d:%02d",
+                tm_time->tm_year + 1900, tm_time->tm_mon + 1, tm_time->tm_mday,
+                tm_time->tm_hour, tm_time->tm_min, tm_time->tm_sec);
+    }
+    report("now + localtime + snprintf", iterations, start);
+
+    start = Timestamp::monotonicNow();
+    for(int i = 0; i < iterations; i++) {
+        g_sink += Timestamp::now().toString().size();
+    }
+    report("now + toString", iterations, start);
+
+    start = Timestamp::monotonicNow();
+    for(int i = 0; i < iterations; i++) {
+        g_sink += Timestamp::now().formatTo(buf, sizeof buf);
+    }
+    report("now + formatTo", iterations, start);
+    return 0;
+}
@@ -0,0 +1,93 @@
+// idle-timeout bookkeeping for 1M simulated connections:
+// TimingWheel touch/tick against TimerQueue cancel + reinsert on every read.
+#include "EventLoop.h"
+#include "TimerId.h"
+#include "TimingWheel.h"
+#include "Timestamp.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+
+static double elapsedSeconds(Timestamp start) {
+    return timeDifference(Timestamp::now(), start);
+}
+
+int main(int argc, char *argv[]) {
+    const int numConns = argc > 1 ? atoi(argv[1]) : 1000000;
+    const int timeout = 8;
+    const int readsPerConn = 4;
+
+    EventLoop loop;
+
+    // timing wheel
+    std::shared_ptr<TimingWheel> wheel(new TimingWheel(&loop, timeout));
+    size_t expired = 0;
+    wheel->setExpireCallback([&expired](const std::shared_ptr<void>&) { ++expired; });
+
+    std::vector<std::shared_ptr<int>> conns;
+    std::vector<TimingWheel::EntryPtr> entries;
+    conns.reserve(numConns);
+    entries.reserve(numConns);
+
+    Timestamp start(Timestamp::now());
+    for(int i = 0; i < numConns; i++) {
+        conns.emplace_back(new int(i));
+        entries.push_back(wheel->add(conns.back()));
+    }
+    printf("wheel: add %d conns in %.3fs\n", numConns, elapsedSeconds(start));
+
+    // every connection reads a few times per second, only the first read of a tick does any work
+    start = Timestamp::now();
+    for(int r = 0; r < readsPerConn; r++) {
+        for(int i = 0; i < numConns; i++) {
+            wheel->touch(entries[i]);
+        }
+        wheel->tick();
+    }
+    double touchSeconds = elapsedSeconds(start);
+    printf("wheel: %d touches + %d ticks in %.3fs, %.1f ns/touch\n",
+            numConns * readsPerConn, readsPerConn, touchSeconds, touchSeconds * 1e9 / (numConns * readsPerConn));
+
+    // half the connections go quiet and must expire after the timeout
+    start = Timestamp::now();
+    double maxTick = 0;
+    for(int t = 0; t <= timeout; t++) {
+        for(int i = 0; i < numConns; i += 2) {
+            wheel->touch(entries[i]);
+        }
+        Timestamp tickStart(Timestamp::now());
+        wheel->tick();
+        double tickSeconds = elapsedSeconds(tickStart);
+        if(tickSeconds > maxTick)
+            maxTick = tickSeconds;
+    }
+    printf("wheel: expired %lu of %d idle conns, slowest tick %.3fms\n", expired, numConns / 2, maxTick * 1e3);
+
+    entries.clear();
+    wheel.reset();
+
+    // heap timers, cancel and reinsert on every read
+    std::vector<TimerId> timers;
+    timers.reserve(numConns);
+    start = Timestamp::now();
+    for(int i = 0; i < numConns; i++) {
+        timers.push_back(loop.runAfter(timeout, [](){}));
+    }
+    printf("timer queue: add %d timers in %.3fs\n", numConns, elapsedSeconds(start));
+
+    start = Timestamp::now();
+    for(int r = 0; r < readsPerConn; r++) {
+        for(int i = 0; i < numConns; i++) {
+            loop.cancel(timers[i]);
+            timers[i] = loop.runAfter(timeout, [](){});
+        }
+    }
+    double resetSeconds = elapsedSeconds(start);
+    printf("timer queue: %d cancel+reinsert in %.3fs, %.1f ns/reset\n",
+            numConns * readsPerConn, resetSeconds, resetSeconds * 1e9 / (numConns * readsPerConn));
+
+    return 0;
+}
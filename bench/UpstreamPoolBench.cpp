@@ -0,0 +1,125 @@
+// request latency through UpstreamPool against a loopback echo upstream: every request acquires a
+// connection, sends a 64 byte message, waits for the echo and releases the connection. maxIdle=0 closes
+// each connection on release, so every request pays for connect and close; pooled keeps them warm.
+// usage: upstream_pool_bench [requests] [concurrency] [--json]
+#include "BenchCommon.h"
+#include "EventLoop.h"
+#include "UpstreamPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+using namespace bench;
+
+using Clock = std::chrono::steady_clock;
+
+static const size_t kMessageBytes = 64;
+
+struct Result {
+    LatencyRecorder recorder;
+    double seconds = 0;
+    int failed = 0;
+};
+
+// runs `concurrency` request chains on one client loop until `requests` have completed
+static Result run(const char *mode, size_t maxIdle, int requests, int concurrency, uint16_t port) {
+    EchoServerThread server(port, 1);
+    EventLoop loop;
+    UpstreamPool pool(&loop, InetAddress(port), mode);
+    pool.setMaxIdle(maxIdle);
+
+    const std::string message(kMessageBytes, 'x');
+    Result result;
+    result.recorder.reserve(requests);
+    int started = 0;
+    int finished = 0;
+    std::unordered_map<TcpConnection*, Clock::time_point> inFlight;
+    std::function<void()> next;
+
+    auto finish = [&]() {
+        if(++finished == requests)
+            loop.quit();
+        else if(started < requests)
+            next();
+    };
+    next = [&]() {
+        started++;
+        Clock::time_point start = Clock::now();
+        pool.acquire([&, start](const TcpConnectionPtr &conn) {
+            if(!conn) {
+                result.failed++;
+                finish();
+                return;
+            }
+            inFlight[conn.get()] = start;
+            conn->send(message);
+        });
+    };
+    pool.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        if(buf->readableBytes() < kMessageBytes)
+            return;
+        buf->retrieve(kMessageBytes);
+        auto it = inFlight.find(conn.get());
+        result.recorder.record(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - it->second).count());
+        inFlight.erase(it);
+        pool.release(conn);
+        finish();
+    });
+    pool.setLeaseLostCallback([&](const TcpConnectionPtr &conn) {
+        inFlight.erase(conn.get());
+        result.failed++;
+        finish();
+    });
+
+    Clock::time_point begin = Clock::now();
+    loop.queueInLoop([&]() {
+        for(int i = 0; i < concurrency && started < requests; i++)
+            next();
+    });
+    loop.loop();
+    result.seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    const bool json = takeFlag(argc, argv, "--json");
+    const int requests = argc > 1 ? atoi(argv[1]) : 5000;
+    const int concurrency = argc > 2 ? atoi(argv[2]) : 4;
+    Logger::setLogLevel(Logger::ERROR);
+
+    struct Mode {
+        const char *name;
+        size_t maxIdle;
+    };
+    const Mode modes[] = {{"fresh", 0}, {"pooled", UpstreamPool::kDefaultMaxIdle}};
+
+    std::vector<JsonObject> results;
+    uint16_t port = 19700;
+    if(!json)
+        printf("%-8s %10s %10s %10s %10s %8s\n", "mode", "req/s", "p50 us", "p99 us", "max us", "failed");
+    for(const Mode &mode: modes) {
+        Result r = run(mode.name, mode.maxIdle, requests, concurrency, port++);
+        double rate = r.recorder.count() / r.seconds;
+        if(!json)
+            printf("%-8s %10.0f %10.1f %10.1f %10.1f %8d\n", mode.name, rate, r.recorder.percentile(50) / 1000.0,
+                    r.recorder.percentile(99) / 1000.0, r.recorder.percentile(100) / 1000.0, r.failed);
+        results.push_back(JsonObject()
+                .add("mode", std::string(mode.name))
+                .add("concurrency", concurrency)
+                .add("requests", static_cast<int64_t>(r.recorder.count()))
+                .add("failed", r.failed)
+                .add("req_per_sec", rate)
+                .add("p50_us", r.recorder.percentile(50) / 1000.0)
+                .add("p99_us", r.recorder.percentile(99) / 1000.0)
+                .add("max_us", r.recorder.percentile(100) / 1000.0));
+    }
+    if(json)
+        printJson("upstream_pool", results);
+    return 0;
+}
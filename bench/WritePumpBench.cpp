@@ -0,0 +1,198 @@
+// epoll_ctl calls per MiB for a server that streams from its write complete callback, the usual way to send
+// more than fits in memory. handleWrite drops EPOLLOUT once the output drains, the callback then sends the
+// next chunk and, when the socket is full, asks for EPOLLOUT again, all in the same loop iteration.
+// echo mode is the request/response case: the server echoes from its message callback while the client
+// pipelines requests and reads the replies slowly, so echoes write partially and EPOLLOUT toggles under
+// backpressure. post mode queues each echo back to the loop instead, like a reply computed by a worker
+// pool: it runs after handleWrite in the same iteration, so a drop of EPOLLOUT is often followed by a re-arm.
+// epoll_ctl is interposed here so the library's calls are counted, accept4 to cap the echo server's send buffer.
+// usage: write_pump_bench [conns] [MiB per conn] [chunk KiB] [pump|echo|post]
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Logger.h"
+#include "TcpServer.h"
+#include "Timestamp.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+
+static std::atomic_long g_epollCtl(0);
+
+extern "C" int epoll_ctl(int epfd, int op, int fd, struct epoll_event *event) {
+    ++g_epollCtl;
+    return static_cast<int>(syscall(SYS_epoll_ctl, epfd, op, fd, event));
+}
+
+// SO_SNDBUF for accepted sockets, 0 keeps the kernel's autotuned one. loopback grows the send buffer to
+// megabytes, echoes would then never write partially
+static int g_serverSndbuf = 0;
+
+extern "C" int accept4(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int flags) {
+    int fd = static_cast<int>(syscall(SYS_accept4, sockfd, addr, addrlen, flags));
+    if(fd >= 0 && g_serverSndbuf > 0)
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &g_serverSndbuf, sizeof g_serverSndbuf);
+    return fd;
+}
+
+struct Pump {
+    std::shared_ptr<const std::string> chunk;
+    size_t remaining;
+};
+
+static void pumpNext(const TcpConnectionPtr &conn, Pump *pump) {
+    if(pump->remaining == 0) {
+        conn->shutdown();
+        return ;
+    }
+    size_t len = std::min(pump->remaining, pump->chunk->size());
+    pump->remaining -= len;
+    conn->send(pump->chunk, 0, len);
+}
+
+static int connectClient(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    // a small window keeps the server's socket buffer near full
+    int rcvbuf = 32 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(connect(fd, (sockaddr*)&addr, sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+// reads totalBytes slower than the server writes them, so its socket fills and EPOLLOUT is needed.
+// progress, when given, follows the bytes received so far
+static void drainSlowly(int fd, size_t totalBytes, std::atomic<size_t> *progress = nullptr) {
+    std::vector<char> buf(16 * 1024);
+    size_t received = 0;
+    for(int calls = 1; received < totalBytes; calls++) {
+        ssize_t n = recv(fd, buf.data(), buf.size(), 0);
+        if(n <= 0)
+            break;
+        received += n;
+        if(progress)
+            progress->store(received);
+        if(calls % 8 == 0)
+            usleep(200);
+    }
+    if(received < totalBytes)
+        fprintf(stderr, "client got %zu of %zu bytes\n", received, totalBytes);
+}
+
+static void runPumpClient(uint16_t port, size_t totalBytes, size_t) {
+    int fd = connectClient(port);
+    drainSlowly(fd, totalBytes);
+    close(fd);
+}
+
+// pipelines requestSize requests from a second thread, at most kEchoWindow bytes ahead of the replies
+// read so far, like a client with a bounded number of requests in flight. the window is larger than the
+// server's send buffer so echoes write partially, and the server's output drains whenever the client
+// catches up, so EPOLLOUT keeps toggling
+static const size_t kEchoWindow = 512 * 1024;
+
+static void runEchoClient(uint16_t port, size_t totalBytes, size_t requestSize) {
+    int fd = connectClient(port);
+    std::atomic<size_t> received(0);
+    std::thread writer([fd, totalBytes, requestSize, &received]() {
+        std::string request(requestSize, 'x');
+        for(size_t sent = 0; sent < totalBytes; ) {
+            if(sent - received.load() >= kEchoWindow) {
+                usleep(100);
+                continue;
+            }
+            ssize_t n = write(fd, request.data(), std::min(request.size(), totalBytes - sent));
+            if(n <= 0)
+                break;
+            sent += n;
+        }
+    });
+    drainSlowly(fd, totalBytes, &received);
+    writer.join();
+    close(fd);
+}
+
+int main(int argc, char *argv[]) {
+    const int numConns = argc > 1 ? atoi(argv[1]) : 8;
+    const size_t bytesPerConn = (argc > 2 ? atol(argv[2]) : 64) * 1024 * 1024;
+    const size_t chunkSize = (argc > 3 ? atol(argv[3]) : 64) * 1024;
+    const char *mode = argc > 4 ? argv[4] : "pump";
+    const bool echo = strcmp(mode, "echo") == 0 || strcmp(mode, "post") == 0;
+    const bool post = strcmp(mode, "post") == 0;
+    const uint16_t port = 19300;
+    if(echo)
+        g_serverSndbuf = 64 * 1024;
+    Logger::setLogLevel(Logger::ERROR);
+
+    EventLoop *serverLoop = nullptr;
+    std::atomic_bool ready(false);
+    std::thread server([&]() {
+        EventLoop loop;
+        std::shared_ptr<const std::string> chunk(new std::string(chunkSize, 'x'));
+        TcpServer server(&loop, InetAddress(port, "127.0.0.1"), "WritePumpBench");
+        server.setConnectionCallback([chunk, bytesPerConn, echo](const TcpConnectionPtr &conn) {
+            if(conn->connected() && !echo) {
+                std::shared_ptr<Pump> pump(new Pump{chunk, bytesPerConn});
+                conn->setWriteCompleteCallback([pump](const TcpConnectionPtr &conn) {
+                    pumpNext(conn, pump.get());
+                });
+                pumpNext(conn, pump.get());
+            }
+        });
+        server.setMessageCallback([echo, post](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+            if(post) {
+                std::shared_ptr<std::string> reply(new std::string(buf->retrieveAllAsString()));
+                conn->getLoop()->queueInLoop([conn, reply]() { conn->send(std::move(*reply)); });
+            }
+            else if(echo)
+                conn->send(buf->retrieveAllAsString());
+            else
+                buf->retrieveAll();
+        });
+        server.start();
+        serverLoop = &loop;
+        ready = true;
+        loop.loop();
+    });
+    while(!ready)
+        usleep(1000);
+
+    g_epollCtl = 0;
+    Timestamp start(Timestamp::now());
+    std::vector<std::thread> clients;
+    for(int i = 0; i < numConns; i++) {
+        clients.emplace_back(echo ? runEchoClient : runPumpClient, port, bytesPerConn, chunkSize);
+    }
+    for(std::thread &t: clients) {
+        t.join();
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    long epollCtl = g_epollCtl;
+    serverLoop->quit();
+    server.join();
+
+    double mb = static_cast<double>(numConns) * bytesPerConn / (1024 * 1024);
+    printf("%s conns=%d chunk=%zuKiB %.0fMiB in %.2fs, epoll_ctl=%ld (%.2f per MiB), %.1f MiB/s\n",
+            mode, numConns, chunkSize / 1024, mb, seconds, epollCtl, epollCtl / mb, mb / seconds);
+    return 0;
+}
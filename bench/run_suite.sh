@@ -0,0 +1,15 @@
+#!/bin/bash
+# runs the loopback suite and leaves one JSON report per bench in the output directory.
+# build with optimisation first, e.g. cmake -DCMAKE_BUILD_TYPE=Release, the numbers are meaningless at -O0
+# usage: bench/run_suite.sh [output dir] [seconds per point]
+set -e
+
+BIN=$(cd $(dirname $0)/.. && pwd)/bin
+OUT=${1:-bench-results}
+SECONDS_PER_POINT=${2:-1}
+
+mkdir -p $OUT
+$BIN/echo_throughput_bench $SECONDS_PER_POINT --json > $OUT/echo_throughput.json
+$BIN/pingpong_latency_bench --json > $OUT/pingpong_latency.json
+$BIN/connect_churn_bench $SECONDS_PER_POINT --json > $OUT/connect_churn.json
+echo "reports in $OUT"
@@ -1,14 +1,32 @@
 #include "Acceptor.h"
+#include "EventLoop.h"
 #include "InetAddress.h"
 #include "Logger.h"
 
+#include <algorithm>
 #include <cerrno>
+#include <fcntl.h>
 #include <functional>
 #include <netinet/in.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 
+const int Acceptor::kMaxRetryDelayMs;
+
+static int openIdleFd() {
+    return open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+AcceptStats& AcceptStats::operator+=(const AcceptStats &rhs) {
+    accepted += rhs.accepted;
+    rejected += rhs.rejected;
+    wakeups += rhs.wakeups;
+    largestBatch = std::max(largestBatch, rhs.largestBatch);
+    paused += rhs.paused;
+    return *this;
+}
+
 static int createNonBlocking() {
     int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
     if(sockfd < 0)
@@ -20,7 +38,15 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
     loop_(loop),
     acceptSocket_(createNonBlocking()),
     acceptChannel_(loop, acceptSocket_.fd()),
-    listenning_(false) {
+    listenning_(false),
+    maxAcceptsPerWakeup_(kDefaultMaxAcceptsPerWakeup),
+    idleFd_(openIdleFd()),
+    retryDelayMs_(kInitRetryDelayMs),
+    accepted_(0),
+    rejected_(0),
+    wakeups_(0),
+    largestBatch_(0),
+    paused_(0) {
 
     acceptSocket_.setReuseAddr(true);
     acceptSocket_.setReusePort(reuseport);
@@ -30,14 +56,35 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusepor
 }
 
 Acceptor::~Acceptor() {
+    loop_->cancel(retryTimer_);
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    if(idleFd_ >= 0)
+        close(idleFd_);
 }
 
 void Acceptor::setNewConnectionCallback(const NewConnectionCallback &cb) {
     newConnectionCallback_ = cb;
 }
 
+EventLoop* Acceptor::ownerLoop() const {
+    return loop_;
+}
+
+void Acceptor::setMaxAcceptsPerWakeup(int n) {
+    maxAcceptsPerWakeup_ = std::max(n, 1);
+}
+
+AcceptStats Acceptor::stats() const {
+    AcceptStats stats;
+    stats.accepted = accepted_.load(std::memory_order_relaxed);
+    stats.rejected = rejected_.load(std::memory_order_relaxed);
+    stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+    stats.largestBatch = largestBatch_.load(std::memory_order_relaxed);
+    stats.paused = paused_.load(std::memory_order_relaxed);
+    return stats;
+}
+
 bool Acceptor::listenning() const {
     return listenning_;
 }
@@ -48,21 +95,66 @@ void Acceptor::listen() {
     acceptChannel_.enableReading();
 }
 
+// drain the backlog up to maxAcceptsPerWakeup_, what is left keeps the fd readable for the next poll
 void Acceptor::handleRead() {
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if(connfd >= 0) {
-        if(newConnectionCallback_)
-            newConnectionCallback_(connfd, peerAddr);
-        else
-            close(connfd);
-    }
-    else {
-        LOG_ERROR("%s:%s:%d => accept socket fd accept error, do not execute connection, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, errno);
-        if(errno == EMFILE)
-            LOG_ERROR("%s:%s:%d => socket fd reach limit, do not execute connection.", __FILENAME__, __FUNCTION__, __LINE__);
+    uint64_t batch = 0;
+    for(int i = 0; i < maxAcceptsPerWakeup_; i++) {
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if(connfd >= 0) {
+            ++batch;
+            if(newConnectionCallback_)
+                newConnectionCallback_(connfd, peerAddr);
+            else
+                close(connfd);
+            continue;
+        }
+
+        int savedErrno = errno;
+        if(savedErrno == EAGAIN || savedErrno == EWOULDBLOCK)
+            break;
+        // the peer gave up before we got to it, or a signal, just try the next one
+        if(savedErrno == ECONNABORTED || savedErrno == EINTR)
+            continue;
+        if(savedErrno == EMFILE || savedErrno == ENFILE) {
+            // the reserve fd is gone when another thread took the fd it freed last time
+            if(idleFd_ < 0) {
+                pauseAccepting();
+                break;
+            }
+            LOG_ERROR("%s:%s:%d => socket fd reach limit, reject connection.", __FILENAME__, __FUNCTION__, __LINE__);
+            close(idleFd_);
+            idleFd_ = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+            if(idleFd_ >= 0) {
+                close(idleFd_);
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+            }
+            idleFd_ = openIdleFd();
+            continue;
+        }
+
+        LOG_ERROR("%s:%s:%d => accept socket fd accept error, do not execute connection, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, savedErrno);
+        break;
     }
-}
 
+    if(batch > 0)
+        retryDelayMs_ = kInitRetryDelayMs;
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    accepted_.fetch_add(batch, std::memory_order_relaxed);
+    if(batch > largestBatch_.load(std::memory_order_relaxed))
+        largestBatch_.store(batch, std::memory_order_relaxed);
+}
 
+void Acceptor::pauseAccepting() {
+    LOG_ERROR("%s:%s:%d => socket fd reach limit and no reserve fd left, stop accepting for %d ms.", __FILENAME__, __FUNCTION__, __LINE__, retryDelayMs_);
+    acceptChannel_.disableReading();
+    paused_.fetch_add(1, std::memory_order_relaxed);
+    retryTimer_ = loop_->runAfter(retryDelayMs_ / 1000.0, std::bind(&Acceptor::resumeAccepting, this));
+    retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
+}
 
+void Acceptor::resumeAccepting() {
+    if(idleFd_ < 0)
+        idleFd_ = openIdleFd();
+    acceptChannel_.enableReading();
+}
@@ -3,13 +3,27 @@
 #include "Channel.h"
 #include "noncopyable.h"
 #include "Socket.h"
+#include "TimerId.h"
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 
 
 class InetAddress;
 class EventLoop;
 
+// accept counters, a snapshot taken with Acceptor::stats()
+struct AcceptStats {
+    uint64_t accepted = 0;      // handed to the new connection callback
+    uint64_t rejected = 0;      // accepted and closed straight away because the process ran out of fds
+    uint64_t wakeups = 0;       // readable events on the listen fd, accepted / wakeups is the mean batch
+    uint64_t largestBatch = 0;
+    uint64_t paused = 0;        // times accepting stopped for a while because no fd was left to shed connections with
+
+    AcceptStats& operator+=(const AcceptStats &rhs);
+};
+
 class Acceptor: noncopyable {
 public:
     using NewConnectionCallback = std::function<void(int, const InetAddress&)>;
@@ -18,12 +32,20 @@ public:
     ~Acceptor();
 
     void setNewConnectionCallback(const NewConnectionCallback &cb);
+    // upper bound on connections taken per readable event, so a connect storm cannot starve the loop's other fds
+    void setMaxAcceptsPerWakeup(int n);
+    AcceptStats stats() const;
 
+    EventLoop* ownerLoop() const;
     bool listenning() const;
     void listen();
 
 private:
     void handleRead();
+    // stop reading the listen fd and try again after retryDelayMs_, a level-triggered listen fd whose
+    // pending connections cannot be taken would otherwise wake the loop over and over
+    void pauseAccepting();
+    void resumeAccepting();
 
 private:
     EventLoop *loop_;
@@ -31,6 +53,25 @@ private:
     Channel acceptChannel_;
     NewConnectionCallback newConnectionCallback_;
     bool listenning_;
+    int maxAcceptsPerWakeup_;
+    // held open so that on EMFILE it can be given up to accept and close the pending connection,
+    // otherwise the listen fd stays readable and the loop spins
+    int idleFd_;
+    int retryDelayMs_;
+    TimerId retryTimer_;
+
+    // written only in the loop thread, read from anywhere
+    std::atomic<uint64_t> accepted_;
+    std::atomic<uint64_t> rejected_;
+    std::atomic<uint64_t> wakeups_;
+    std::atomic<uint64_t> largestBatch_;
+    std::atomic<uint64_t> paused_;
+
+public:
+    static const int kDefaultMaxAcceptsPerWakeup = 64;
+    // pauses double from kInitRetryDelayMs up to kMaxRetryDelayMs, a successful accept starts over
+    static const int kInitRetryDelayMs = 100;
+    static const int kMaxRetryDelayMs = 2 * 1000;
 };
 
 
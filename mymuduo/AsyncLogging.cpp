@@ -0,0 +1,312 @@
+#include "AsyncLogging.h"
+#include "CurrentThread.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+
+class AsyncLogging::LogBuffer {
+public:
+    LogBuffer(): data_(new char[kBufferSize]), length_(0) {}
+
+    const char* data() const { return data_.get(); }
+    size_t length() const { return length_; }
+    size_t avail() const { return kBufferSize - length_; }
+
+    void append(const char *buf, size_t len) {
+        memcpy(data_.get() + length_, buf, len);
+        length_ += len;
+    }
+
+    void reset() { length_ = 0; }
+
+private:
+    std::unique_ptr<char[]> data_;
+    size_t length_;
+};
+
+static std::atomic_int s_numAsyncLogging(0);
+
+struct AsyncLogging::ThreadBuffers {
+    ~ThreadBuffers();
+
+    // by AsyncLogging id, ids are never reused
+    std::vector<std::pair<int, ThreadBufferPtr>> entries;
+
+    // the last AsyncLogging this thread logged to
+    static thread_local int cachedId;
+    static thread_local ThreadBuffer *cachedBuffer;
+    // set once the thread's ThreadBuffers is destroyed, later lines from its other thread_local destructors are dropped
+    static thread_local bool exiting;
+};
+
+thread_local int AsyncLogging::ThreadBuffers::cachedId = 0;
+thread_local AsyncLogging::ThreadBuffer *AsyncLogging::ThreadBuffers::cachedBuffer = nullptr;
+thread_local bool AsyncLogging::ThreadBuffers::exiting = false;
+
+AsyncLogging::ThreadBuffers::~ThreadBuffers() {
+    exiting = true;
+    cachedId = 0;
+    cachedBuffer = nullptr;
+    for(std::pair<int, ThreadBufferPtr> &entry: entries) {
+        ThreadBuffer *tb = entry.second.get();
+        std::unique_lock<std::mutex> lock(tb->mutex);
+        if(tb->owner)
+            tb->owner->retireThreadBuffer(tb);
+    }
+}
+
+AsyncLogging::AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval):
+    id_(++s_numAsyncLogging),
+    flushInterval_(flushInterval),
+    basename_(basename),
+    rollSize_(rollSize),
+    running_(false),
+    droppedLines_(0),
+    thread_(std::bind(&AsyncLogging::threadFunc, this), "AsyncLogging"),
+    flushRequested_(0),
+    flushed_(0),
+    writing_(false),
+    allocatedBuffers_(0) {}
+
+AsyncLogging::~AsyncLogging() {
+    if(running_)
+        stop();
+
+    // threads still alive keep their ThreadBuffer, it must no longer point here
+    std::vector<ThreadBufferPtr> threadBuffers;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        threadBuffers.swap(threadBuffers_);
+    }
+    for(const ThreadBufferPtr &tb: threadBuffers) {
+        std::unique_lock<std::mutex> lock(tb->mutex);
+        tb->owner = nullptr;
+    }
+}
+
+void AsyncLogging::append(const char *logline, size_t len) {
+    ThreadBuffer *tb = threadBuffer();
+    if(tb == nullptr) {
+        droppedLines_++;
+        return;
+    }
+    std::unique_lock<std::mutex> lock(tb->mutex);
+    if(tb->current && tb->current->avail() > len) {
+        tb->current->append(logline, len);
+        return;
+    }
+
+    BufferPtr next;
+    {
+        std::unique_lock<std::mutex> globalLock(mutex_);
+        if(tb->current)
+            fullBuffers_.push_back(std::move(tb->current));
+        next = newBufferLocked();
+    }
+    cond_.notify_one();
+
+    tb->current = std::move(next);
+    if(tb->current && tb->current->avail() > len)
+        tb->current->append(logline, len);
+    else
+        droppedLines_++;
+}
+
+void AsyncLogging::flush() {
+    // a FATAL logged by the background thread itself cannot wait for itself
+    if(!running_ || CurrentThread::tid() == thread_.tid())
+        return;
+
+    std::vector<ThreadBufferPtr> threadBuffers;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        threadBuffers = threadBuffers_;
+    }
+    // lines still sitting in thread buffers, append takes a new buffer once current is gone
+    for(const ThreadBufferPtr &tb: threadBuffers) {
+        std::unique_lock<std::mutex> lock(tb->mutex);
+        if(tb->current && tb->current->length() > 0) {
+            std::unique_lock<std::mutex> globalLock(mutex_);
+            fullBuffers_.push_back(std::move(tb->current));
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t ticket = ++flushRequested_;
+    cond_.notify_one();
+    flushedCond_.wait(lock, [this, ticket]() { return flushed_ >= ticket || !writing_; });
+}
+
+void AsyncLogging::start() {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        writing_ = true;
+    }
+    running_ = true;
+    thread_.start();
+}
+
+void AsyncLogging::stop() {
+    running_ = false;
+    cond_.notify_one();
+    thread_.join();
+}
+
+uint64_t AsyncLogging::droppedLines() const {
+    return droppedLines_;
+}
+
+AsyncLogging::ThreadBuffer* AsyncLogging::threadBuffer() {
+    if(ThreadBuffers::cachedId == id_)
+        return ThreadBuffers::cachedBuffer;
+    if(ThreadBuffers::exiting)
+        return nullptr;
+
+    static thread_local ThreadBuffers t_buffers;
+    std::vector<std::pair<int, ThreadBufferPtr>> &entries = t_buffers.entries;
+    for(std::pair<int, ThreadBufferPtr> &entry: entries) {
+        if(entry.first == id_) {
+            ThreadBuffers::cachedId = id_;
+            ThreadBuffers::cachedBuffer = entry.second.get();
+            return ThreadBuffers::cachedBuffer;
+        }
+    }
+
+    // first line from this thread to this AsyncLogging. drop entries of instances destroyed meanwhile
+    for(size_t i = 0; i < entries.size(); ) {
+        std::unique_lock<std::mutex> lock(entries[i].second->mutex);
+        bool gone = entries[i].second->owner == nullptr;
+        lock.unlock();
+        if(gone) {
+            entries[i] = std::move(entries.back());
+            entries.pop_back();
+        }
+        else
+            i++;
+    }
+
+    ThreadBufferPtr tb(std::make_shared<ThreadBuffer>());
+    tb->owner = this;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        tb->current = newBufferLocked();
+        threadBuffers_.push_back(tb);
+    }
+    entries.emplace_back(id_, tb);
+    ThreadBuffers::cachedId = id_;
+    ThreadBuffers::cachedBuffer = tb.get();
+    return ThreadBuffers::cachedBuffer;
+}
+
+void AsyncLogging::retireThreadBuffer(ThreadBuffer *tb) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if(tb->current) {
+            if(tb->current->length() > 0)
+                fullBuffers_.push_back(std::move(tb->current));
+            else
+                freeBuffers_.push_back(std::move(tb->current));
+        }
+        for(size_t i = 0; i < threadBuffers_.size(); i++) {
+            if(threadBuffers_[i].get() == tb) {
+                threadBuffers_.erase(threadBuffers_.begin() + i);
+                break;
+            }
+        }
+    }
+    tb->owner = nullptr;
+    cond_.notify_one();
+}
+
+AsyncLogging::BufferPtr AsyncLogging::newBufferLocked() {
+    if(!freeBuffers_.empty()) {
+        BufferPtr buffer = std::move(freeBuffers_.back());
+        freeBuffers_.pop_back();
+        return buffer;
+    }
+    if(allocatedBuffers_ >= kMaxBuffers)
+        return BufferPtr();
+
+    allocatedBuffers_++;
+    return BufferPtr(new LogBuffer);
+}
+
+void AsyncLogging::threadFunc() {
+    LogFile output(basename_, rollSize_);
+    BufferVector buffersToWrite;
+    BufferVector spares;
+    std::vector<ThreadBufferPtr> threadBuffers;
+    uint64_t reportedDrops = 0;
+
+    // keep going after stop() until everything appended so far is written
+    bool lastRound = false;
+    while(!lastRound) {
+        lastRound = !running_;
+        uint64_t flushTicket;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if(fullBuffers_.empty() && flushed_ == flushRequested_ && running_)
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            buffersToWrite.swap(fullBuffers_);
+            // flush() queued its buffers before taking the ticket, so they are in buffersToWrite
+            flushTicket = flushRequested_;
+
+            // shared, a thread exiting meanwhile must not free the ThreadBuffer under us
+            threadBuffers = threadBuffers_;
+            while(spares.size() < threadBuffers.size()) {
+                BufferPtr buffer = newBufferLocked();
+                if(!buffer)
+                    break;
+                spares.push_back(std::move(buffer));
+            }
+        }
+
+        // pick up partially filled buffers so lines show up within flushInterval
+        for(const ThreadBufferPtr &tb: threadBuffers) {
+            std::unique_lock<std::mutex> lock(tb->mutex);
+            if(tb->current && tb->current->length() > 0 && !spares.empty()) {
+                buffersToWrite.push_back(std::move(tb->current));
+                tb->current = std::move(spares.back());
+                spares.pop_back();
+            }
+        }
+
+        for(const BufferPtr &buffer: buffersToWrite) {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        uint64_t dropped = droppedLines_;
+        if(dropped != reportedDrops) {
+            char buf[128];
+            int n = snprintf(buf, sizeof buf, "%s: dropped %lu log lines, backend too slow.\n",
+                    Timestamp::now().toString().c_str(), dropped - reportedDrops);
+            fputs(buf, stderr);
+            output.append(buf, n);
+            reportedDrops = dropped;
+        }
+        output.flush();
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            for(BufferPtr &buffer: buffersToWrite) {
+                buffer->reset();
+                freeBuffers_.push_back(std::move(buffer));
+            }
+            flushed_ = flushTicket;
+        }
+        flushedCond_.notify_all();
+        buffersToWrite.clear();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        writing_ = false;
+    }
+    flushedCond_.notify_all();
+}
+
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+
+// asynchronous logging backend. every logging thread appends to its own fixed-size buffer,
+// full buffers are handed to a background thread that writes them to a rolling LogFile,
+// and partially filled ones are collected every flushInterval seconds.
+// appending never touches the disk and never waits for it: once kMaxBuffers are in flight, new lines are dropped and counted.
+//
+// to route LOG_* through it, point Logger at functions forwarding to append() and flush():
+//     AsyncLogging *g_asyncLog;
+//     void asyncOutput(const char *msg, size_t len) { g_asyncLog->append(msg, len); }
+//     void asyncFlush() { g_asyncLog->flush(); }
+//     Logger::instance().setOutput(asyncOutput);
+//     Logger::instance().setFlush(asyncFlush);
+// Logger calls the flush hook after a FATAL line, so the line is on disk before the process exits.
+class AsyncLogging: noncopyable {
+public:
+    AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval = 3);
+    ~AsyncLogging();
+
+    // thread safe
+    void append(const char *logline, size_t len);
+
+    // synchronous: hands every thread's buffer to the background thread and returns once all lines
+    // appended so far are written and the file is flushed. thread safe, a no-op unless started
+    void flush();
+
+    void start();
+    void stop();
+
+    uint64_t droppedLines() const;
+
+private:
+    class LogBuffer;
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    struct ThreadBuffer {
+        std::mutex mutex;
+        BufferPtr current;
+        // guarded by mutex, null once the AsyncLogging is gone
+        AsyncLogging *owner = nullptr;
+    };
+    using ThreadBufferPtr = std::shared_ptr<ThreadBuffer>;
+    // the calling thread's buffers, one per AsyncLogging it logs to, handed back when the thread exits
+    struct ThreadBuffers;
+
+    // nullptr while the calling thread is exiting
+    ThreadBuffer* threadBuffer();
+    // the thread of tb exits: queue or free its buffer and forget it. must hold tb->mutex
+    void retireThreadBuffer(ThreadBuffer *tb);
+    // must hold mutex_
+    BufferPtr newBufferLocked();
+
+    void threadFunc();
+
+private:
+    static const size_t kBufferSize = 256 * 1024;
+    static const size_t kMaxBuffers = 64;
+
+    const int id_;
+    const int flushInterval_;
+    const std::string basename_;
+    const off_t rollSize_;
+
+    std::atomic_bool running_;
+    std::atomic<uint64_t> droppedLines_;
+    Thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    // flush() waits on flushedCond_ until flushed_ reaches its ticket or the background thread is gone
+    std::condition_variable flushedCond_;
+    uint64_t flushRequested_;
+    uint64_t flushed_;
+    bool writing_;
+    std::vector<ThreadBufferPtr> threadBuffers_;
+    BufferVector fullBuffers_;
+    BufferVector freeBuffers_;
+    size_t allocatedBuffers_;
+};
+
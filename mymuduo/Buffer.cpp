@@ -1,24 +1,82 @@
 #include "Buffer.h"
+#include "BufferPool.h"
+#include "ByteScan.h"
 
 #include <algorithm>
 #include <cerrno>
+#include <cstring>
+#include <endian.h>
 #include <string>
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
 
+// what peek()/beginWrite() point into while no storage is held
+static const char kEmptyStorage[Buffer::kCheapPrepend] = {0};
+
 Buffer::Buffer(size_t initialSize):
-    buffer_(kCheapPrepend + initialSize),
+    buffer_(nullptr),
+    capacity_(0),
+    initialSize_(initialSize),
+    readerIndex_(kCheapPrepend),
+    writerIndex_(kCheapPrepend),
+    scanned_(0),
+    scanKind_(kScanNone) {}
+
+Buffer::~Buffer() {
+    release();
+}
+
+Buffer::Buffer(const Buffer &rhs):
+    buffer_(nullptr),
+    capacity_(0),
+    initialSize_(rhs.initialSize_),
     readerIndex_(kCheapPrepend),
-    writerIndex_(kCheapPrepend) {}
+    writerIndex_(kCheapPrepend),
+    scanned_(0),
+    scanKind_(kScanNone) {
+
+    append(rhs.peek(), rhs.readableBytes());
+}
+
+Buffer::Buffer(Buffer &&rhs) noexcept:
+    buffer_(rhs.buffer_),
+    capacity_(rhs.capacity_),
+    initialSize_(rhs.initialSize_),
+    readerIndex_(rhs.readerIndex_),
+    writerIndex_(rhs.writerIndex_),
+    scanned_(rhs.scanned_),
+    scanKind_(rhs.scanKind_) {
+
+    rhs.buffer_ = nullptr;
+    rhs.capacity_ = 0;
+    rhs.readerIndex_ = rhs.writerIndex_ = kCheapPrepend;
+    rhs.scanned_ = 0;
+    rhs.scanKind_ = kScanNone;
+}
+
+Buffer& Buffer::operator=(Buffer rhs) {
+    swap(rhs);
+    return *this;
+}
+
+void Buffer::swap(Buffer &rhs) {
+    std::swap(buffer_, rhs.buffer_);
+    std::swap(capacity_, rhs.capacity_);
+    std::swap(initialSize_, rhs.initialSize_);
+    std::swap(readerIndex_, rhs.readerIndex_);
+    std::swap(writerIndex_, rhs.writerIndex_);
+    std::swap(scanned_, rhs.scanned_);
+    std::swap(scanKind_, rhs.scanKind_);
+}
 
 size_t Buffer::readableBytes() const {
     return writerIndex_ - readerIndex_;
 }
 
 size_t Buffer::writableBytes() const {
-    return buffer_.size() - writerIndex_;
+    return capacity_ - std::min(capacity_, writerIndex_);
 }
 
 size_t Buffer::prependableBytes() const {
@@ -30,20 +88,46 @@ const char* Buffer::peek() const {
 }
 
 const char* Buffer::findCRLF() const {
-    const char kCRLF[] = "\r\n";
-    const char *crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF+2);
-    return crlf == beginWrite() ? nullptr : crlf;
+    return ByteScan::findCRLF(peek(), beginWrite());
+}
+
+const char* Buffer::findCRLF(const char *start) const {
+    return ByteScan::findCRLF(start, beginWrite());
+}
+
+const char* Buffer::findEOL() const {
+    return ByteScan::findByte(peek(), beginWrite(), '\n');
+}
+
+const char* Buffer::findEOL(const char *start) const {
+    return ByteScan::findByte(start, beginWrite(), '\n');
+}
+
+const char* Buffer::find(const char *needle, size_t len) const {
+    return ByteScan::find(peek(), beginWrite(), needle, len);
+}
+
+const char* Buffer::scanCRLF() {
+    return scan(kScanCRLF);
+}
+
+const char* Buffer::scanEOL() {
+    return scan(kScanEOL);
 }
 
 void Buffer::retrieve(size_t len) {
-    if(len < readableBytes())
+    if(len < readableBytes()) {
         readerIndex_ += len;
+        scanned_ = scanned_ > len ? scanned_ - len : 0;
+    }
     else
         retrieveAll();
 }
 
 void Buffer::retrieveAll() {
     readerIndex_ = writerIndex_ = kCheapPrepend;
+    scanned_ = 0;
+    release();
 }
 
 std::string Buffer::retrieveAsString(size_t len) {
@@ -75,8 +159,122 @@ const char* Buffer::beginWrite() const {
     return begin() + writerIndex_;
 }
 
+void Buffer::hasWritten(size_t len) {
+    writerIndex_ += std::min(len, writableBytes());
+}
+
+void Buffer::prepend(const void *data, size_t len) {
+    if(buffer_ == nullptr)
+        reallocate(kCheapPrepend + initialSize_);
+    if(prependableBytes() < len)
+        reallocate(capacity_ + len, kCheapPrepend + len);
+    readerIndex_ -= len;
+    memcpy(begin() + readerIndex_, data, len);
+    // nothing is known about the new front bytes
+    scanned_ = 0;
+}
+
+void Buffer::appendInt64(int64_t x) {
+    uint64_t be = htobe64(static_cast<uint64_t>(x));
+    append(reinterpret_cast<const char*>(&be), sizeof be);
+}
+
+void Buffer::appendInt32(int32_t x) {
+    uint32_t be = htobe32(static_cast<uint32_t>(x));
+    append(reinterpret_cast<const char*>(&be), sizeof be);
+}
+
+void Buffer::appendInt16(int16_t x) {
+    uint16_t be = htobe16(static_cast<uint16_t>(x));
+    append(reinterpret_cast<const char*>(&be), sizeof be);
+}
+
+void Buffer::appendInt8(int8_t x) {
+    append(reinterpret_cast<const char*>(&x), sizeof x);
+}
+
+void Buffer::prependInt64(int64_t x) {
+    uint64_t be = htobe64(static_cast<uint64_t>(x));
+    prepend(&be, sizeof be);
+}
+
+void Buffer::prependInt32(int32_t x) {
+    uint32_t be = htobe32(static_cast<uint32_t>(x));
+    prepend(&be, sizeof be);
+}
+
+void Buffer::prependInt16(int16_t x) {
+    uint16_t be = htobe16(static_cast<uint16_t>(x));
+    prepend(&be, sizeof be);
+}
+
+void Buffer::prependInt8(int8_t x) {
+    prepend(&x, sizeof x);
+}
+
+int64_t Buffer::peekInt64() const {
+    uint64_t be;
+    memcpy(&be, peek(), sizeof be);
+    return static_cast<int64_t>(be64toh(be));
+}
+
+int32_t Buffer::peekInt32() const {
+    uint32_t be;
+    memcpy(&be, peek(), sizeof be);
+    return static_cast<int32_t>(be32toh(be));
+}
+
+int16_t Buffer::peekInt16() const {
+    uint16_t be;
+    memcpy(&be, peek(), sizeof be);
+    return static_cast<int16_t>(be16toh(be));
+}
+
+int8_t Buffer::peekInt8() const {
+    return static_cast<int8_t>(*peek());
+}
+
+int64_t Buffer::readInt64() {
+    int64_t x = peekInt64();
+    retrieve(sizeof x);
+    return x;
+}
+
+int32_t Buffer::readInt32() {
+    int32_t x = peekInt32();
+    retrieve(sizeof x);
+    return x;
+}
+
+int16_t Buffer::readInt16() {
+    int16_t x = peekInt16();
+    retrieve(sizeof x);
+    return x;
+}
+
+int8_t Buffer::readInt8() {
+    int8_t x = peekInt8();
+    retrieve(sizeof x);
+    return x;
+}
+
+void Buffer::shrink(size_t reserve) {
+    if(readableBytes() == 0)
+        release();
+    else if(BufferPool::roundUp(kCheapPrepend + readableBytes() + reserve) < capacity_)
+        reallocate(kCheapPrepend + readableBytes() + reserve);
+}
+
+size_t Buffer::capacity() const {
+    return capacity_;
+}
+
 ssize_t Buffer::readFd(int fd, int *saveErrno) {
-    char extrabuf[65536] = {0};
+    // left uninitialized on purpose, readv only ever writes into it
+    char extrabuf[kExtraBufSize];
+
+    if(buffer_ == nullptr)
+        reallocate(kCheapPrepend + initialSize_);
 
     struct iovec vec[2];
     const size_t writable = writableBytes();
@@ -94,10 +292,12 @@ ssize_t Buffer::readFd(int fd, int *saveErrno) {
     else if(n <= writable)
         writerIndex_ += n;
     else {
-        writerIndex_ = buffer_.size();
+        writerIndex_ = capacity_;
         append(extrabuf, n - writable);
     }
 
+    if(readableBytes() == 0)
+        release();
     return n;
 }
 
@@ -109,23 +309,62 @@ ssize_t Buffer::writeFd(int fd, int *saveErrno) {
 }
 
 char* Buffer::begin() {
-    return &*buffer_.begin();
+    return buffer_ ? buffer_ : const_cast<char*>(kEmptyStorage);
 }
 
 const char* Buffer::begin() const {
-    return &*buffer_.begin();
+    return buffer_ ? buffer_ : kEmptyStorage;
 }
 
 void Buffer::makeSpace(size_t len) {
-    if(writableBytes() + prependableBytes() - kCheapPrepend < len)
-        buffer_.resize(writerIndex_ + len);
+    if(buffer_ == nullptr)
+        reallocate(kCheapPrepend + std::max(len, initialSize_));
+    else if(writableBytes() + prependableBytes() - kCheapPrepend < len)
+        reallocate(writerIndex_ + len);
     else {
         size_t readable = readableBytes();
-        std::copy(begin() + readerIndex_, begin() + writerIndex_, begin() + kCheapPrepend);
+        memmove(begin() + kCheapPrepend, begin() + readerIndex_, readable);
         readerIndex_ = kCheapPrepend;
         writerIndex_ = readerIndex_ + readable;
     }
 }
 
+// move the readable bytes into a fresh pool block of at least size bytes, prepend bytes from its start
+void Buffer::reallocate(size_t size, size_t prepend) {
+    size_t readable = readableBytes();
+    size_t capacity = BufferPool::roundUp(std::max(size, prepend + readable));
+    char *buffer = BufferPool::local().allocate(capacity);
+    if(readable > 0)
+        memcpy(buffer + prepend, peek(), readable);
 
+    release();
+    buffer_ = buffer;
+    capacity_ = capacity;
+    readerIndex_ = prepend;
+    writerIndex_ = readerIndex_ + readable;
+}
 
+void Buffer::release() {
+    if(buffer_) {
+        BufferPool::local().deallocate(buffer_, capacity_);
+        buffer_ = nullptr;
+        capacity_ = 0;
+    }
+}
+
+const char* Buffer::scan(ScanKind kind) {
+    const size_t from = scanKind_ == kind ? std::min<size_t>(scanned_, readableBytes()) : 0;
+    const char *found = kind == kScanCRLF ? ByteScan::findCRLF(peek() + from, beginWrite())
+                                          : ByteScan::findByte(peek() + from, beginWrite(), '\n');
+    size_t clean;
+    if(found)
+        clean = found - peek();
+    else {
+        // a trailing '\r' can still be completed by the next read
+        const size_t readable = readableBytes();
+        clean = kind == kScanCRLF && readable > 0 ? readable - 1 : readable;
+    }
+    scanKind_ = kind;
+    scanned_ = static_cast<uint32_t>(std::min<size_t>(clean, UINT32_MAX));
+    return found;
+}
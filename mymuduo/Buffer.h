@@ -1,21 +1,41 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <sys/types.h>
-#include <vector>
 
 
+// contiguous buffer whose storage comes from the thread's BufferPool.
+// storage is taken lazily on the first write and handed back to the pool whenever the buffer is drained,
+// so idle connections hold no buffer memory and buffers shrink back after traffic bursts.
 class Buffer {
 public:
     explicit Buffer(size_t initialSize = kInitialSize);
+    ~Buffer();
+
+    Buffer(const Buffer &rhs);
+    Buffer(Buffer &&rhs) noexcept;
+    Buffer& operator=(Buffer rhs);
+    void swap(Buffer &rhs);
 
     size_t readableBytes() const;
     size_t writableBytes() const;
     size_t prependableBytes() const;
 
     const char* peek() const;
+    // delimiter searches over the readable bytes, nullptr when there is no match. see ByteScan
     const char* findCRLF() const;
+    const char* findCRLF(const char *start) const;
+    const char* findEOL() const;
+    const char* findEOL(const char *start) const;
+    const char* find(const char *needle, size_t len) const;
+
+    // findCRLF()/findEOL() for parsers called on every partial read: a miss remembers how far it got and
+    // the next call scans only bytes that arrived since. the mark moves with retrieve(), and the two
+    // share it, so switching between them starts over from peek()
+    const char* scanCRLF();
+    const char* scanEOL();
 
     void retrieve(size_t len);
     void retrieveAll();
@@ -28,23 +48,66 @@ public:
     void append(const char *data, size_t len);
     char* beginWrite();
     const char* beginWrite() const;
+    // mark len bytes written straight into beginWrite() as readable
+    void hasWritten(size_t len);
+
+    // put len bytes in front of the readable bytes. fits in place up to prependableBytes(), which is at
+    // least kCheapPrepend once data has been appended; larger headers move the data once
+    void prepend(const void *data, size_t len);
+
+    // integers in network byte order. peek and read need that many readable bytes
+    void appendInt64(int64_t x);
+    void appendInt32(int32_t x);
+    void appendInt16(int16_t x);
+    void appendInt8(int8_t x);
+
+    void prependInt64(int64_t x);
+    void prependInt32(int32_t x);
+    void prependInt16(int16_t x);
+    void prependInt8(int8_t x);
+
+    int64_t peekInt64() const;
+    int32_t peekInt32() const;
+    int16_t peekInt16() const;
+    int8_t peekInt8() const;
+
+    int64_t readInt64();
+    int32_t readInt32();
+    int16_t readInt16();
+    int8_t readInt8();
+
+    // give back to the pool any capacity beyond the readable bytes plus reserve
+    void shrink(size_t reserve);
+    size_t capacity() const;
 
     ssize_t readFd(int fd, int *saveErrno);
     ssize_t writeFd(int fd, int *saveErrno);
 
 private:
+    enum ScanKind {kScanNone, kScanCRLF, kScanEOL};
+
     char* begin();
     const char* begin() const;
     void makeSpace(size_t len);
+    void reallocate(size_t capacity, size_t prepend = kCheapPrepend);
+    void release();
+    const char* scan(ScanKind kind);
 
 public:
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;
+    // stack spill area of readFd, one call reads at most writableBytes() plus this much
+    static const size_t kExtraBufSize = 65536;
 
 private:
-    std::vector<char> buffer_;
+    char *buffer_;
+    size_t capacity_;
+    size_t initialSize_;
     size_t readerIndex_;
     size_t writerIndex_;
+    // readable bytes from peek() that the last scan of scanKind_ found no delimiter start in.
+    // 32 bits keep the Buffer small enough to be bound into a queued send without a heap allocation
+    uint32_t scanned_;
+    ScanKind scanKind_;
 };
 
-
@@ -0,0 +1,62 @@
+#include "BufferPool.h"
+
+
+BufferPool::BufferPool(): cachedBytes_(0) {}
+
+BufferPool::~BufferPool() {
+    for(int i = 0; i < kNumSizeClasses; i++) {
+        for(char *data: freeLists_[i]) {
+            delete[] data;
+        }
+    }
+}
+
+BufferPool& BufferPool::local() {
+    static thread_local BufferPool pool;
+    return pool;
+}
+
+size_t BufferPool::roundUp(size_t size) {
+    size_t rounded = kMinSlabSize;
+    while(rounded < size) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+char* BufferPool::allocate(size_t size) {
+    int index = sizeClass(size);
+    if(index < 0 || freeLists_[index].empty())
+        return new char[size];
+
+    char *data = freeLists_[index].back();
+    freeLists_[index].pop_back();
+    cachedBytes_ -= size;
+    return data;
+}
+
+void BufferPool::deallocate(char *data, size_t size) {
+    int index = sizeClass(size);
+    if(index >= 0 && cachedBytes_ + size <= kMaxCachedBytes) {
+        freeLists_[index].push_back(data);
+        cachedBytes_ += size;
+    }
+    else
+        delete[] data;
+}
+
+size_t BufferPool::cachedBytes() const {
+    return cachedBytes_;
+}
+
+int BufferPool::sizeClass(size_t size) {
+    if(size > kMaxSlabSize)
+        return -1;
+
+    int index = 0;
+    while((kMinSlabSize << index) < size) {
+        index++;
+    }
+    return index;
+}
+
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <cstddef>
+#include <vector>
+
+
+// size-classed free lists for Buffer and ChainBuffer storage.
+// there is one pool per thread, so every EventLoop allocates from and returns to its own pool without locking.
+// requests are rounded up to a power of two between kMinSlabSize and kMaxSlabSize, larger ones bypass the pool.
+class BufferPool: noncopyable {
+public:
+    ~BufferPool();
+
+    static BufferPool& local();
+    static size_t roundUp(size_t size);
+
+    // size must be the value returned by roundUp, i.e. the capacity handed out
+    char* allocate(size_t size);
+    void deallocate(char *data, size_t size);
+
+    size_t cachedBytes() const;
+
+public:
+    static const size_t kMinSlabSize = 512;
+    static const size_t kMaxSlabSize = 64 * 1024;
+    // per thread over all size classes. frees beyond it go back to the allocator, so after a burst a
+    // loop thread keeps at most this much cached
+    static const size_t kMaxCachedBytes = 4 * 1024 * 1024;
+
+private:
+    BufferPool();
+
+    static int sizeClass(size_t size);
+
+private:
+    static const int kNumSizeClasses = 8;
+
+    std::vector<char*> freeLists_[kNumSizeClasses];
+    size_t cachedBytes_;
+};
+
@@ -0,0 +1,315 @@
+#include "ByteScan.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MUDUO_BYTESCAN_X86 1
+#include <immintrin.h>
+#endif
+
+
+namespace {
+
+struct Kernels {
+    ByteScan::Isa isa;
+    const char* (*findByte)(const char *begin, const char *end, char c);
+    // len >= 2
+    const char* (*find)(const char *begin, const char *end, const char *needle, size_t len);
+};
+
+// glibc's memchr is vectorized already, the scalar set leans on it
+const char* scalarFindByte(const char *begin, const char *end, char c) {
+    return begin < end ? static_cast<const char*>(memchr(begin, c, end - begin)) : nullptr;
+}
+
+const char* scalarFind(const char *begin, const char *end, const char *needle, size_t len) {
+    if(end - begin < static_cast<ptrdiff_t>(len))
+        return nullptr;
+    const char *last = end - len;
+    for(const char *p = begin; p <= last; p++) {
+        p = static_cast<const char*>(memchr(p, needle[0], last - p + 1));
+        if(p == nullptr)
+            return nullptr;
+        if(memcmp(p + 1, needle + 1, len - 1) == 0)
+            return p;
+    }
+    return nullptr;
+}
+
+#ifdef MUDUO_BYTESCAN_X86
+
+// the vector loops take four registers per round and test their combined mask once, matches are located
+// only in the round that has one. the last partial block is one load ending at the input's end,
+// overlapping bytes already checked, whose mask is shifted past them. the AVX2 kernels do their 16 byte
+// steps inline rather than calling the SSE2 ones: legacy SSE code right after AVX code pays a state
+// transition on every call
+
+__attribute__((target("sse2")))
+inline uint64_t sse2Eq(const char *p, __m128i target) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), target)));
+}
+
+// positions i of the 16 at p where the needle's first byte is at p + i and its last at p + i + len - 1
+__attribute__((target("sse2")))
+inline uint64_t sse2Candidates(const char *p, size_t len, __m128i first, __m128i last) {
+    __m128i head = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), first);
+    __m128i tail = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + len - 1)), last);
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(head, tail)));
+}
+
+__attribute__((target("avx2")))
+inline uint64_t avx2Eq(const char *p, __m256i target) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), target)));
+}
+
+__attribute__((target("avx2")))
+inline uint64_t avx2Candidates(const char *p, size_t len, __m256i first, __m256i last) {
+    __m256i head = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), first);
+    __m256i tail = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + len - 1)), last);
+    return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(head, tail)));
+}
+
+// the first candidate of mask, bit i standing for p + i, that has the needle's middle bytes too
+inline const char* verify(const char *p, uint64_t mask, const char *needle, size_t len) {
+    for(; mask; mask &= mask - 1) {
+        const char *candidate = p + __builtin_ctzll(mask);
+        if(len == 2 || memcmp(candidate + 1, needle + 1, len - 2) == 0)
+            return candidate;
+    }
+    return nullptr;
+}
+
+inline const char* byteLoop(const char *p, const char *end, char c) {
+    for(; p < end; p++)
+        if(*p == c)
+            return p;
+    return nullptr;
+}
+
+// the last candidate position is end - len
+__attribute__((target("sse2")))
+const char* sse2Find(const char *begin, const char *end, const char *needle, size_t len) {
+    const ptrdiff_t block = static_cast<ptrdiff_t>(len + 15);
+    if(end - begin < block)
+        return scalarFind(begin, end, needle, len);
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[len - 1]);
+    const char *p = begin;
+    for(; end - p >= block + 48; p += 64) {
+        uint64_t mask = sse2Candidates(p, len, first, last) | sse2Candidates(p + 16, len, first, last) << 16
+                | sse2Candidates(p + 32, len, first, last) << 32 | sse2Candidates(p + 48, len, first, last) << 48;
+        if(mask) {
+            if(const char *found = verify(p, mask, needle, len))
+                return found;
+        }
+    }
+    for(; end - p >= block; p += 16) {
+        if(const char *found = verify(p, sse2Candidates(p, len, first, last), needle, len))
+            return found;
+    }
+    if(end - p < static_cast<ptrdiff_t>(len))
+        return nullptr;
+    const char *q = end - block;
+    return verify(p, sse2Candidates(q, len, first, last) >> (p - q), needle, len);
+}
+
+__attribute__((target("avx2")))
+const char* avx2FindByte(const char *begin, const char *end, char c) {
+    if(end - begin < 32) {
+        if(end - begin < 16)
+            return byteLoop(begin, end, c);
+        // two overlapping halves cover 16 to 31 bytes
+        const __m128i target = _mm_set1_epi8(c);
+        uint64_t mask = sse2Eq(begin, target);
+        if(mask)
+            return begin + __builtin_ctzll(mask);
+        const char *q = end - 16;
+        mask = sse2Eq(q, target);
+        return mask ? q + __builtin_ctzll(mask) : nullptr;
+    }
+
+    const __m256i target = _mm256_set1_epi8(c);
+    const char *p = begin;
+    for(; end - p >= 128; p += 128) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), target);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), target);
+        __m256i c4 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 64)), target);
+        __m256i d = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 96)), target);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c4, d));
+        if(!_mm256_testz_si256(any, any)) {
+            uint64_t low = static_cast<uint32_t>(_mm256_movemask_epi8(a)) | uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(b))) << 32;
+            if(low)
+                return p + __builtin_ctzll(low);
+            uint64_t high = static_cast<uint32_t>(_mm256_movemask_epi8(c4)) | uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(d))) << 32;
+            return p + 64 + __builtin_ctzll(high);
+        }
+    }
+    for(; end - p >= 32; p += 32) {
+        uint64_t mask = avx2Eq(p, target);
+        if(mask)
+            return p + __builtin_ctzll(mask);
+    }
+    if(p == end)
+        return nullptr;
+    const char *q = end - 32;
+    uint64_t mask = avx2Eq(q, target) >> (p - q);
+    return mask ? p + __builtin_ctzll(mask) : nullptr;
+}
+
+__attribute__((target("avx2")))
+const char* avx2Find(const char *begin, const char *end, const char *needle, size_t len) {
+    const ptrdiff_t block = static_cast<ptrdiff_t>(len + 31);
+    if(end - begin < block) {
+        const ptrdiff_t half = static_cast<ptrdiff_t>(len + 15);
+        if(end - begin < half)
+            return scalarFind(begin, end, needle, len);
+        // two overlapping 16 position blocks cover the rest
+        const __m128i first = _mm_set1_epi8(needle[0]);
+        const __m128i last = _mm_set1_epi8(needle[len - 1]);
+        if(const char *found = verify(begin, sse2Candidates(begin, len, first, last), needle, len))
+            return found;
+        const char *q = end - half;
+        return verify(q, sse2Candidates(q, len, first, last), needle, len);
+    }
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[len - 1]);
+    const char *p = begin;
+    for(; end - p >= block + 96; p += 128) {
+        uint64_t low = avx2Candidates(p, len, first, last) | avx2Candidates(p + 32, len, first, last) << 32;
+        uint64_t high = avx2Candidates(p + 64, len, first, last) | avx2Candidates(p + 96, len, first, last) << 32;
+        if(low | high) {
+            if(const char *found = verify(p, low, needle, len))
+                return found;
+            if(const char *found = verify(p + 64, high, needle, len))
+                return found;
+        }
+    }
+    for(; end - p >= block; p += 32) {
+        if(const char *found = verify(p, avx2Candidates(p, len, first, last), needle, len))
+            return found;
+    }
+    if(end - p < static_cast<ptrdiff_t>(len))
+        return nullptr;
+    const char *q = end - block;
+    return verify(p, avx2Candidates(q, len, first, last) >> (p - q), needle, len);
+}
+
+#endif
+
+const Kernels kScalarKernels = {ByteScan::kScalar, scalarFindByte, scalarFind};
+#ifdef MUDUO_BYTESCAN_X86
+// an SSE2 byte loop does not beat glibc's memchr, which is SSE2 at least
+const Kernels kSse2Kernels = {ByteScan::kSse2, scalarFindByte, sse2Find};
+const Kernels kAvx2Kernels = {ByteScan::kAvx2, avx2FindByte, avx2Find};
+#endif
+
+const Kernels* kernelsFor(ByteScan::Isa isa) {
+#ifdef MUDUO_BYTESCAN_X86
+    if(isa == ByteScan::kAvx2)
+        return &kAvx2Kernels;
+    if(isa == ByteScan::kSse2)
+        return &kSse2Kernels;
+#endif
+    return &kScalarKernels;
+}
+
+const Kernels* detectKernels() {
+    ByteScan::Isa best = ByteScan::kScalar;
+    if(ByteScan::supported(ByteScan::kAvx2))
+        best = ByteScan::kAvx2;
+    else if(ByteScan::supported(ByteScan::kSse2))
+        best = ByteScan::kSse2;
+
+    if(const char *name = getenv("MUDUO_BYTESCAN")) {
+        for(ByteScan::Isa isa: {ByteScan::kScalar, ByteScan::kSse2, ByteScan::kAvx2}) {
+            if(name == std::string(ByteScan::isaName(isa)) && isa < best)
+                best = isa;
+        }
+    }
+    return kernelsFor(best);
+}
+
+std::atomic<const Kernels*> g_kernels(nullptr);
+
+const Kernels* kernels() {
+    const Kernels *k = g_kernels.load(std::memory_order_relaxed);
+    if(k == nullptr) {
+        // racing first calls all detect the same set
+        k = detectKernels();
+        g_kernels.store(k, std::memory_order_relaxed);
+    }
+    return k;
+}
+
+}
+
+const char* ByteScan::findByte(const char *begin, const char *end, char c) {
+    return kernels()->findByte(begin, end, c);
+}
+
+// in line protocols a '\r' is nearly always the start of a CRLF, so one compare per byte for '\r'
+// beats comparing both bytes of every position
+const char* ByteScan::findCRLF(const char *begin, const char *end) {
+    const Kernels *k = kernels();
+    for(const char *p = begin; end - p >= 2; p++) {
+        p = k->findByte(p, end - 1, '\r');
+        if(p == nullptr)
+            return nullptr;
+        if(p[1] == '\n')
+            return p;
+    }
+    return nullptr;
+}
+
+const char* ByteScan::find(const char *begin, const char *end, const char *needle, size_t len) {
+    if(len == 0)
+        return begin;
+    if(len == 1)
+        return findByte(begin, end, needle[0]);
+    if(end - begin < static_cast<ptrdiff_t>(len))
+        return nullptr;
+    return kernels()->find(begin, end, needle, len);
+}
+
+ByteScan::Isa ByteScan::isa() {
+    return kernels()->isa;
+}
+
+bool ByteScan::setIsa(Isa isa) {
+    if(!supported(isa))
+        return false;
+    g_kernels.store(kernelsFor(isa), std::memory_order_relaxed);
+    return true;
+}
+
+bool ByteScan::supported(Isa isa) {
+    switch(isa) {
+    case kScalar:
+        return true;
+#ifdef MUDUO_BYTESCAN_X86
+    case kSse2:
+        return __builtin_cpu_supports("sse2");
+    case kAvx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* ByteScan::isaName(Isa isa) {
+    switch(isa) {
+    case kSse2:
+        return "sse2";
+    case kAvx2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+
+// delimiter search over [begin, end) for the protocol parsers: a single byte, CRLF, or a short needle.
+// the kernel set is picked once at runtime from what the cpu supports: AVX2, else SSE2, else scalar.
+// MUDUO_BYTESCAN=scalar|sse2|avx2 in the environment forces a set, capped at what the cpu can run.
+// the needle kernels compare 16 or 32 positions at once against the needle's first and last byte and
+// only memcmp the middle of candidates. single bytes use an AVX2 loop or glibc's memchr, which already
+// is vectorized; CRLF is a search for '\r' checked against the next byte.
+// every function returns a pointer to the first match or nullptr
+class ByteScan {
+public:
+    enum Isa {
+        kScalar,
+        kSse2,
+        kAvx2,
+    };
+
+    static const char* findByte(const char *begin, const char *end, char c);
+    static const char* findCRLF(const char *begin, const char *end);
+    // an empty needle matches at begin
+    static const char* find(const char *begin, const char *end, const char *needle, size_t len);
+
+    static Isa isa();
+    // switch kernels, e.g. to compare them. false, with nothing changed, if the cpu lacks isa
+    static bool setIsa(Isa isa);
+    static bool supported(Isa isa);
+    static const char* isaName(Isa isa);
+};
@@ -0,0 +1,104 @@
+#include "ChainBuffer.h"
+#include "BufferPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+
+
+ChainBuffer::ChainBuffer(): head_(0), readableBytes_(0) {}
+
+ChainBuffer::~ChainBuffer() {
+    retrieveAll();
+}
+
+size_t ChainBuffer::readableBytes() const {
+    return readableBytes_;
+}
+
+size_t ChainBuffer::numBlocks() const {
+    return blocks_.size() - head_;
+}
+
+void ChainBuffer::append(const char *data, size_t len) {
+    readableBytes_ += len;
+    while(len > 0) {
+        if(blocks_.size() == head_ || blocks_.back().writerIndex == kBlockSize)
+            blocks_.push_back(Block{BufferPool::local().allocate(kBlockSize), 0, 0});
+
+        Block &tail = blocks_.back();
+        size_t n = std::min(len, kBlockSize - tail.writerIndex);
+        memcpy(tail.data + tail.writerIndex, data, n);
+        tail.writerIndex += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::retrieve(size_t len) {
+    if(len >= readableBytes_) {
+        retrieveAll();
+        return;
+    }
+
+    readableBytes_ -= len;
+    while(len > 0) {
+        Block &head = blocks_[head_];
+        size_t n = std::min(len, head.writerIndex - head.readerIndex);
+        head.readerIndex += n;
+        len -= n;
+        if(head.readerIndex == head.writerIndex)
+            releaseFront();
+    }
+}
+
+void ChainBuffer::retrieveAll() {
+    while(head_ < blocks_.size()) {
+        releaseFront();
+    }
+    readableBytes_ = 0;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno) {
+    return writeFd(fd, saveErrno, readableBytes_);
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *saveErrno, size_t maxBytes) {
+    struct iovec vec[kMaxIovecs];
+    int iovcnt = frontIovecs(vec, kMaxIovecs, maxBytes);
+
+    ssize_t n = writev(fd, vec, iovcnt);
+    if(n < 0)
+        *saveErrno = errno;
+    return n;
+}
+
+int ChainBuffer::frontIovecs(struct iovec *vec, int maxIovecs, size_t maxBytes) const {
+    int iovcnt = 0;
+    for(size_t i = head_; i < blocks_.size() && iovcnt < maxIovecs && maxBytes > 0; i++, iovcnt++) {
+        size_t len = std::min(maxBytes, blocks_[i].writerIndex - blocks_[i].readerIndex);
+        vec[iovcnt].iov_base = blocks_[i].data + blocks_[i].readerIndex;
+        vec[iovcnt].iov_len = len;
+        maxBytes -= len;
+    }
+    return iovcnt;
+}
+
+void ChainBuffer::releaseFront() {
+    BufferPool::local().deallocate(blocks_[head_].data, kBlockSize);
+    head_++;
+
+    if(head_ == blocks_.size()) {
+        if(blocks_.capacity() > kKeptBlockSlots)
+            std::vector<Block>().swap(blocks_);
+        else
+            blocks_.clear();
+        head_ = 0;
+    }
+    else if(head_ * 2 >= blocks_.size()) {
+        blocks_.erase(blocks_.begin(), blocks_.begin() + head_);
+        head_ = 0;
+    }
+}
+
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <cstddef>
+#include <sys/types.h>
+#include <vector>
+
+
+struct iovec;
+
+// output buffer made of fixed-size blocks from the thread's BufferPool.
+// append never relocates queued bytes, writeFd hands the whole chain to writev,
+// and retrieve gives fully consumed blocks back to the pool.
+// codecs that need contiguous data keep using Buffer.
+class ChainBuffer: noncopyable {
+public:
+    ChainBuffer();
+    ~ChainBuffer();
+
+    size_t readableBytes() const;
+    size_t numBlocks() const;
+
+    void append(const char *data, size_t len);
+
+    void retrieve(size_t len);
+    void retrieveAll();
+
+    ssize_t writeFd(int fd, int *saveErrno);
+    // write at most maxBytes from the front of the chain
+    ssize_t writeFd(int fd, int *saveErrno, size_t maxBytes);
+    // point up to maxIovecs iovecs at no more than maxBytes from the front of the chain, nothing is consumed.
+    // returns how many were filled
+    int frontIovecs(struct iovec *vec, int maxIovecs, size_t maxBytes) const;
+
+private:
+    struct Block {
+        char *data;
+        size_t readerIndex;
+        size_t writerIndex;
+    };
+
+    void releaseFront();
+
+public:
+    static const size_t kBlockSize = 16 * 1024;
+
+private:
+    static const int kMaxIovecs = 64;
+    // block slots an empty chain keeps allocated for the next send, a larger list left by a burst is freed
+    static const size_t kKeptBlockSlots = 8;
+
+    // blocks_[head_] is the oldest block. an empty chain holds no blocks and at most kKeptBlockSlots slots
+    std::vector<Block> blocks_;
+    size_t head_;
+    size_t readableBytes_;
+};
+
@@ -12,7 +12,7 @@ const int Channel::kReadEvent = EPOLLIN | EPOLLPRI;
 const int Channel::kWriteEvent = EPOLLOUT;
 
 Channel::Channel(EventLoop *loop, int fd):
-    loop_(loop), fd_(fd), events_(0), revents_(0), index_(-1), tied_(false) {}
+    loop_(loop), fd_(fd), events_(0), revents_(0), index_(-1), registeredEvents_(0), edgeTriggered_(false), tied_(false) {}
 
 Channel::~Channel() {}
 
@@ -55,6 +55,12 @@ int Channel::events() const {
     return events_;
 }
 
+int Channel::pollEvents() const {
+    if(edgeTriggered_ && events_ != kNoneEvent)
+        return events_ | kWriteEvent | EPOLLET;
+    return events_;
+}
+
 void Channel::set_revents(int revt) {
     revents_ = revt;
 }
@@ -70,13 +76,17 @@ void Channel::disableReading() {
 }
 
 void Channel::enableWriting() {
+    int registered = pollEvents();
     events_ |= kWriteEvent;
-    update();
+    if(pollEvents() != registered)
+        update();
 }
 
 void Channel::disableWriting() {
+    int registered = pollEvents();
     events_ &= ~kWriteEvent;
-    update();
+    if(pollEvents() != registered)
+        update();
 }
 
 void Channel::disableAll() {
@@ -84,6 +94,14 @@ void Channel::disableAll() {
     update();
 }
 
+void Channel::setEdgeTriggered(bool on) {
+    edgeTriggered_ = on && loop_->edgeTriggeredSupported();
+}
+
+bool Channel::edgeTriggered() const {
+    return edgeTriggered_;
+}
+
 bool Channel::isNoneEvent() const {
     return events_ == kNoneEvent;
 }
@@ -104,6 +122,14 @@ void Channel::set_index(int idx) {
     index_ = idx;
 }
 
+int Channel::registeredEvents() const {
+    return registeredEvents_;
+}
+
+void Channel::set_registeredEvents(int events) {
+    registeredEvents_ = events;
+}
+
 EventLoop* Channel::ownerLoop() {
     return loop_;
 }
@@ -134,7 +160,9 @@ void Channel::handleEventWithGuard(Timestamp receiveTime) {
             readCallback_(receiveTime);
     }
 
-    if(revents_ & EPOLLOUT) {
+    // edge-triggered channels see EPOLLOUT whether or not they have anything to write.
+    // a finished completion write (see Poller::attachIoBuffers) comes without write interest
+    if((revents_ & EPOLLOUT) && (isWriting() || !edgeTriggered_)) {
         if(writeCallback_)
             writeCallback_();
     }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "InlineFunction.h"
 #include "Timestamp.h"
 #include "noncopyable.h"
 
@@ -11,8 +12,8 @@ class EventLoop;
 
 class Channel: noncopyable {
 public:
-    typedef std::function<void()> EventCallback;
-    using ReadEventCallback = std::function<void(Timestamp)>;
+    typedef InlineFunction<void()> EventCallback;
+    using ReadEventCallback = InlineFunction<void(Timestamp)>;
 
     Channel(EventLoop *loop, int fd);
     ~Channel();
@@ -28,6 +29,8 @@ public:
 
     int fd() const;
     int events() const;
+    // the mask handed to the poller, differs from events() only in edge-triggered mode
+    int pollEvents() const;
     void set_revents(int revt);
 
     void enableReading();
@@ -36,6 +39,13 @@ public:
     void disableWriting();
     void disableAll();
 
+    // edge-triggered: EPOLLOUT is registered for good along with reading, enableWriting/disableWriting
+    // then only flip the bit that gates the write callback instead of issuing an epoll_ctl.
+    // the owner must drain reads and writes until EAGAIN. set before the channel is first enabled.
+    // stays off when the loop's poller is level-triggered only
+    void setEdgeTriggered(bool on);
+    bool edgeTriggered() const;
+
     bool isNoneEvent() const;
     bool isWriting() const;
     bool isReading() const;
@@ -43,6 +53,10 @@ public:
     int index();
     void set_index(int idx);
 
+    // the mask the poller last handed to the kernel, lets it skip changes that change nothing
+    int registeredEvents() const;
+    void set_registeredEvents(int events);
+
     EventLoop* ownerLoop();
     void remove();
 
@@ -60,6 +74,8 @@ private:
     int events_;
     int revents_;
     int index_;
+    int registeredEvents_;
+    bool edgeTriggered_;
 
     std::weak_ptr<void> tie_;
     bool tied_;
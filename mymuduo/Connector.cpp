@@ -0,0 +1,225 @@
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+const int Connector::kInitRetryDelayMs;
+const int Connector::kMaxRetryDelayMs;
+
+static int socketError(int sockfd) {
+    int optval;
+    socklen_t optlen = sizeof optval;
+    if(getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+        return errno;
+    return optval;
+}
+
+// connecting to a port of our own host's ephemeral range can pick itself as the peer
+static bool isSelfConnect(int sockfd) {
+    sockaddr_in local, peer;
+    socklen_t len = sizeof local;
+    memset(&local, 0, sizeof local);
+    memset(&peer, 0, sizeof peer);
+    if(getsockname(sockfd, (sockaddr*)&local, &len) < 0)
+        return false;
+    len = sizeof peer;
+    if(getpeername(sockfd, (sockaddr*)&peer, &len) < 0)
+        return false;
+    return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+}
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr):
+    loop_(loop),
+    serverAddr_(serverAddr),
+    connect_(false),
+    state_(kDisconnected),
+    retryDelayMs_(kInitRetryDelayMs),
+    maxRetries_(0),
+    retries_(0) {
+
+    LOG_DEBUG("%s:%s:%d => connector=%p to %s create.", __FILENAME__, __FUNCTION__, __LINE__, this, serverAddr_.toIpPort().c_str());
+}
+
+Connector::~Connector() {
+    LOG_DEBUG("%s:%s:%d => connector=%p to %s destroy.", __FILENAME__, __FUNCTION__, __LINE__, this, serverAddr_.toIpPort().c_str());
+}
+
+void Connector::setNewConnectionCallback(const NewConnectionCallback &cb) {
+    newConnectionCallback_ = cb;
+}
+
+void Connector::setMaxRetries(int n) {
+    maxRetries_ = std::max(n, 0);
+}
+
+void Connector::setConnectFailedCallback(const std::function<void()> &cb) {
+    connectFailedCallback_ = cb;
+}
+
+const InetAddress& Connector::serverAddress() const {
+    return serverAddr_;
+}
+
+void Connector::start() {
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::restart() {
+    setState(kDisconnected);
+    retryDelayMs_ = kInitRetryDelayMs;
+    retries_ = 0;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::stop() {
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::setState(States state) {
+    state_ = state;
+}
+
+void Connector::startInLoop() {
+    if(connect_ && state_ == kDisconnected)
+        connect();
+}
+
+void Connector::stopInLoop() {
+    loop_->cancel(retryTimer_);
+    if(state_ == kConnecting) {
+        setState(kDisconnected);
+        close(removeAndResetChannel());
+    }
+}
+
+void Connector::connect() {
+    int sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if(sockfd < 0) {
+        LOG_ERROR("%s:%s:%d => connector=%p socket create fail, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, this, errno);
+        retry(-1);
+        return;
+    }
+
+    int ret = ::connect(sockfd, (sockaddr*)serverAddr_.getSockAddr(), sizeof(sockaddr_in));
+    int savedErrno = ret == 0 ? 0 : errno;
+    switch(savedErrno) {
+    case 0:
+    case EINPROGRESS:
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+
+    // transient, worth another try later
+    case EAGAIN:
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case ETIMEDOUT:
+        retry(sockfd);
+        break;
+
+    default:
+        LOG_ERROR("%s:%s:%d => connector=%p connect to %s fail, errno=%d, give up.", __FILENAME__, __FUNCTION__, __LINE__, this, serverAddr_.toIpPort().c_str(), savedErrno);
+        close(sockfd);
+        setState(kDisconnected);
+        connect_ = false;
+        if(connectFailedCallback_)
+            connectFailedCallback_();
+        break;
+    }
+}
+
+void Connector::connecting(int sockfd) {
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    channel_->enableWriting();
+}
+
+// writable means the handshake finished, SO_ERROR says whether it worked
+void Connector::handleWrite() {
+    if(state_ != kConnecting)
+        return;
+
+    int sockfd = removeAndResetChannel();
+    int err = socketError(sockfd);
+    if(err) {
+        LOG_DEBUG("%s:%s:%d => connector=%p connect to %s fail, SO_ERROR=%d.", __FILENAME__, __FUNCTION__, __LINE__, this, serverAddr_.toIpPort().c_str(), err);
+        retry(sockfd);
+    }
+    else if(isSelfConnect(sockfd)) {
+        LOG_ERROR("%s:%s:%d => connector=%p self connect to %s.", __FILENAME__, __FUNCTION__, __LINE__, this, serverAddr_.toIpPort().c_str());
+        retry(sockfd);
+    }
+    else {
+        setState(kConnected);
+        retries_ = 0;
+        if(connect_)
+            newConnectionCallback_(sockfd);
+        else
+            close(sockfd);
+    }
+}
+
+void Connector::handleError() {
+    if(state_ != kConnecting)
+        return;
+
+    int sockfd = removeAndResetChannel();
+    LOG_DEBUG("%s:%s:%d => connector=%p connect to %s error, SO_ERROR=%d.", __FILENAME__, __FUNCTION__, __LINE__, this, serverAddr_.toIpPort().c_str(), socketError(sockfd));
+    retry(sockfd);
+}
+
+void Connector::retry(int sockfd) {
+    if(sockfd >= 0)
+        close(sockfd);
+    setState(kDisconnected);
+    if(!connect_)
+        return;
+
+    if(maxRetries_ > 0 && ++retries_ > maxRetries_) {
+        LOG_ERROR("%s:%s:%d => connector=%p connect to %s fail %d times, give up.", __FILENAME__, __FUNCTION__, __LINE__, this, serverAddr_.toIpPort().c_str(), retries_);
+        connect_ = false;
+        if(connectFailedCallback_)
+            connectFailedCallback_();
+        return;
+    }
+
+    LOG_INFO("%s:%s:%d => connector=%p retry connecting to %s in %d ms.", __FILENAME__, __FUNCTION__, __LINE__, this, serverAddr_.toIpPort().c_str(), retryDelayMs_);
+    // a stopped and released connector must not be kept alive by its retry timer
+    std::weak_ptr<Connector> weakSelf(shared_from_this());
+    retryTimer_ = loop_->runAfter(retryDelayMs_ / 1000.0, [weakSelf]() {
+        ConnectorPtr self = weakSelf.lock();
+        if(self)
+            self->startInLoop();
+    });
+    retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
+}
+
+int Connector::removeAndResetChannel() {
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // we may be inside the channel's handleEvent, destroy it once that returns
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel() {
+    channel_.reset();
+}
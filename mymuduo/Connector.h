@@ -0,0 +1,71 @@
+#pragma once
+
+#include "InetAddress.h"
+#include "noncopyable.h"
+#include "TimerId.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+
+class Channel;
+class EventLoop;
+
+// actively opens one non-blocking TCP connection. connect(2) returns EINPROGRESS, the socket is watched
+// for EPOLLOUT and SO_ERROR tells how the handshake ended. transient failures (refused, unreachable,
+// no local port) are retried after a delay that doubles from kInitRetryDelayMs up to kMaxRetryDelayMs.
+// the established fd is handed to the new connection callback, which owns it from then on.
+// start/stop are thread safe, restart runs in the loop thread
+class Connector: noncopyable, public std::enable_shared_from_this<Connector> {
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb);
+    // 0, the default, retries until stopped
+    void setMaxRetries(int n);
+    // called in the loop thread when the connector gives up: retries used up or a non-transient error
+    void setConnectFailedCallback(const std::function<void()> &cb);
+
+    void start();
+    void restart();
+    void stop();
+
+    const InetAddress& serverAddress() const;
+
+public:
+    static const int kInitRetryDelayMs = 500;
+    static const int kMaxRetryDelayMs = 30 * 1000;
+
+private:
+    enum States {kDisconnected, kConnecting, kConnected};
+
+    void setState(States state);
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    int removeAndResetChannel();
+    void resetChannel();
+
+private:
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_;
+    std::atomic_int state_;
+    std::unique_ptr<Channel> channel_;
+    NewConnectionCallback newConnectionCallback_;
+    std::function<void()> connectFailedCallback_;
+    int retryDelayMs_;
+    int maxRetries_;
+    int retries_;
+    TimerId retryTimer_;
+};
+
+using ConnectorPtr = std::shared_ptr<Connector>;
@@ -0,0 +1,200 @@
+#include "CpuPlacement.h"
+#include "CurrentThread.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+namespace {
+
+// first line of a sysfs file, empty if it cannot be read
+std::string readLine(const std::string &path) {
+    std::string line;
+    FILE *fp = fopen(path.c_str(), "r");
+    if(fp == nullptr)
+        return line;
+    char buf[4096];
+    if(fgets(buf, sizeof buf, fp) != nullptr) {
+        line = buf;
+        while(!line.empty() && (line.back() == '\n' || line.back() == ' '))
+            line.pop_back();
+    }
+    fclose(fp);
+    return line;
+}
+
+std::vector<int> onlineCpus() {
+    std::vector<int> cpus = CpuPlacement::parseCpuList(readLine("/sys/devices/system/cpu/online"));
+    if(cpus.empty()) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        for(int cpu = 0; cpu < n; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+struct Node {
+    int id;
+    std::vector<int> cpus;
+};
+
+// memory-less or cpu-less nodes are left out, a machine without the node directory has no nodes
+std::vector<Node> onlineNodes() {
+    std::vector<Node> nodes;
+    for(int id: CpuPlacement::parseCpuList(readLine("/sys/devices/system/node/online"))) {
+        Node node;
+        node.id = id;
+        node.cpus = CpuPlacement::parseCpuList(readLine("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"));
+        if(!node.cpus.empty())
+            nodes.push_back(node);
+    }
+    return nodes;
+}
+
+// -1 on single-node machines, where a memory policy changes nothing
+int nodeOfCpu(const std::vector<Node> &nodes, int cpu) {
+    if(nodes.size() < 2)
+        return -1;
+    for(const Node &node: nodes) {
+        for(int c: node.cpus) {
+            if(c == cpu)
+                return node.id;
+        }
+    }
+    return -1;
+}
+
+CpuPlacement::Slot pinnedSlot(const std::vector<Node> &nodes, int cpu) {
+    CpuPlacement::Slot slot;
+    slot.cpus.push_back(cpu);
+    slot.node = nodeOfCpu(nodes, cpu);
+    return slot;
+}
+
+}
+
+CpuPlacement::CpuPlacement(): policy_(kNone) {}
+
+CpuPlacement::CpuPlacement(Policy policy): policy_(policy) {}
+
+CpuPlacement CpuPlacement::cpuList(const std::vector<int> &cpus) {
+    CpuPlacement placement(kCpuList);
+    std::vector<Node> nodes = onlineNodes();
+    for(int cpu: cpus) {
+        if(cpu < 0 || cpu >= CPU_SETSIZE) {
+            LOG_ERROR("%s:%s:%d => cpu %d out of range, skipped.", __FILENAME__, __FUNCTION__, __LINE__, cpu);
+            continue;
+        }
+        placement.slots_.push_back(pinnedSlot(nodes, cpu));
+    }
+    return placement;
+}
+
+CpuPlacement CpuPlacement::cpuList(const std::string &list) {
+    std::vector<int> cpus = parseCpuList(list);
+    if(cpus.empty())
+        LOG_ERROR("%s:%s:%d => malformed cpu list \"%s\", threads are not pinned.", __FILENAME__, __FUNCTION__, __LINE__, list.c_str());
+    return cpuList(cpus);
+}
+
+CpuPlacement CpuPlacement::physicalCores() {
+    CpuPlacement placement(kPhysicalCores);
+    std::vector<Node> nodes = onlineNodes();
+    for(int cpu: onlineCpus()) {
+        // a core is represented by the lowest-numbered of its hardware threads
+        std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        std::vector<int> siblings = parseCpuList(readLine(topology + "core_cpus_list"));
+        if(siblings.empty())
+            siblings = parseCpuList(readLine(topology + "thread_siblings_list"));
+        if(siblings.empty() || siblings.front() == cpu)
+            placement.slots_.push_back(pinnedSlot(nodes, cpu));
+    }
+    return placement;
+}
+
+CpuPlacement CpuPlacement::numaNodes() {
+    CpuPlacement placement(kNumaNodes);
+    std::vector<Node> nodes = onlineNodes();
+    for(const Node &node: nodes) {
+        Slot slot;
+        slot.cpus = node.cpus;
+        slot.node = nodes.size() > 1 ? node.id : -1;
+        placement.slots_.push_back(slot);
+    }
+    return placement;
+}
+
+CpuPlacement::Policy CpuPlacement::policy() const {
+    return policy_;
+}
+
+size_t CpuPlacement::numSlots() const {
+    return slots_.size();
+}
+
+CpuPlacement::Slot CpuPlacement::slot(int index) const {
+    if(slots_.empty())
+        return Slot();
+    return slots_[index % slots_.size()];
+}
+
+bool CpuPlacement::apply(const Slot &slot) {
+    if(!slot.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int cpu: slot.cpus) {
+            CPU_SET(cpu, &set);
+        }
+        if(sched_setaffinity(0, sizeof set, &set) < 0) {
+            LOG_ERROR("%s:%s:%d => thread=%d pin to %lu cpus from cpu %d fail, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, CurrentThread::tid(), slot.cpus.size(), slot.cpus.front(), errno);
+            return false;
+        }
+    }
+
+    if(slot.node >= 0) {
+        // one word of node mask; the kernel wants the number of bits plus one
+        unsigned long mask = 0;
+        if(slot.node < static_cast<int>(sizeof mask * 8))
+            mask = 1UL << slot.node;
+        if(mask == 0 || syscall(SYS_set_mempolicy, MPOL_PREFERRED, &mask, sizeof mask * 8 + 1) < 0)
+            LOG_ERROR("%s:%s:%d => thread=%d prefer memory node %d fail, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, CurrentThread::tid(), slot.node, errno);
+    }
+
+    LOG_INFO("%s:%s:%d => thread=%d placed on %lu cpus from cpu %d, memory node %d.", __FILENAME__, __FUNCTION__, __LINE__, CurrentThread::tid(), slot.cpus.size(), slot.cpus.empty() ? -1 : slot.cpus.front(), slot.node);
+    return true;
+}
+
+std::vector<int> CpuPlacement::parseCpuList(const std::string &list) {
+    std::vector<int> cpus;
+    const char *p = list.c_str();
+    while(*p != '\0') {
+        char *end = nullptr;
+        long first = strtol(p, &end, 10);
+        if(end == p || first < 0)
+            return std::vector<int>();
+        long last = first;
+        p = end;
+        if(*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if(end == p + 1 || last < first)
+                return std::vector<int>();
+            p = end;
+        }
+        for(long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+        if(*p == ',')
+            p++;
+        else if(*p != '\0')
+            return std::vector<int>();
+    }
+    return cpus;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+
+// where EventLoopThreadPool runs its loop threads: explicit CPU lists, one loop per physical core,
+// or loops grouped by NUMA node. the topology is read from sysfs once, when the placement is built,
+// and resolved into one Slot per loop; loops beyond the number of slots wrap around.
+// a slot is applied inside the loop thread before its EventLoop is constructed, so the poller, the
+// thread's BufferPool and every connection Buffer it fills are first touched on the slot's node, and on
+// multi-node machines the thread also prefers that node for new pages (set_mempolicy MPOL_PREFERRED).
+class CpuPlacement {
+public:
+    enum Policy {
+        kNone,
+        kCpuList,
+        kPhysicalCores,
+        kNumaNodes,
+    };
+
+    struct Slot {
+        std::vector<int> cpus;  // allowed cpus, empty means not pinned
+        int node = -1;          // preferred memory node, -1 keeps the default policy
+    };
+
+    // leaves threads where the scheduler puts them
+    CpuPlacement();
+
+    // loop i is pinned to cpus[i % cpus.size()]
+    static CpuPlacement cpuList(const std::vector<int> &cpus);
+    // same, from the kernel's list format, e.g. "0-3,8,10-11"
+    static CpuPlacement cpuList(const std::string &list);
+    // loop i is pinned to the first hardware thread of the i-th physical core
+    static CpuPlacement physicalCores();
+    // loops are dealt round-robin over the nodes, each may run on any cpu of its node
+    static CpuPlacement numaNodes();
+
+    Policy policy() const;
+    size_t numSlots() const;
+    Slot slot(int index) const;
+
+    // pins the calling thread, e.g. the base loop's, and sets its memory policy. false if pinning failed
+    static bool apply(const Slot &slot);
+
+    // empty on a malformed list
+    static std::vector<int> parseCpuList(const std::string &list);
+
+private:
+    explicit CpuPlacement(Policy policy);
+
+private:
+    Policy policy_;
+    std::vector<Slot> slots_;
+};
@@ -12,6 +12,7 @@
 const int kNew = -1;
 const int kAdded = 1;
 const int kDeleted = 2;
+const int kNoneEvents = 0;
 
 EPollPoller::EPollPoller(EventLoop *loop):
     Poller(loop), epollfd_(epoll_create1(EPOLL_CLOEXEC)), events_(kInitEventListSize) {
@@ -24,7 +25,7 @@ EPollPoller::~EPollPoller() {
 }
 
 Timestamp EPollPoller::poll(int timeoutMs, ChannelList *activeChannels) {
-    LOG_DEBUG("%s:%s:%d => epoll fd=%d will epoll_wait(), total fd count that be listend is %lu.", __FILENAME__, __FUNCTION__, __LINE__, epollfd_, channels_.size());
+    LOG_DEBUG("%s:%s:%d => epoll fd=%d will epoll_wait(), total fd count that be listend is %lu.", __FILENAME__, __FUNCTION__, __LINE__, epollfd_, numChannels());
 
     int numEvents = epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
     int saveErrno = errno;
@@ -51,9 +52,12 @@ void EPollPoller::updateChannel(Channel *channel) {
     const int index = channel->index();
     LOG_DEBUG("%s:%s:%d => socket fd=%d's channel will update event, events=%d, index=%d.", __FILENAME__, __FUNCTION__, __LINE__, channel->fd(), channel->events(), index);
     if(index == kNew || index == kDeleted) {
-        if(index == kNew) {
-            int fd = channel->fd();
-            channels_[fd] = channel;
+        if(index == kNew)
+            addChannel(channel);
+        // disabled before it was ever enabled, nothing to register
+        if(channel->isNoneEvent()) {
+            channel->set_index(kDeleted);
+            return ;
         }
         channel->set_index(kAdded);
         update(EPOLL_CTL_ADD, channel);
@@ -64,7 +68,8 @@ void EPollPoller::updateChannel(Channel *channel) {
             update(EPOLL_CTL_DEL, channel);
             channel->set_index(kDeleted);
         }
-        else {
+        // same mask as the kernel already has, e.g. enableReading on a reading channel
+        else if(channel->pollEvents() != channel->registeredEvents()) {
             update(EPOLL_CTL_MOD, channel);
         }
     }
@@ -72,7 +77,7 @@ void EPollPoller::updateChannel(Channel *channel) {
 
 void EPollPoller::removeChannel(Channel *channel) {
     int fd = channel->fd();
-    channels_.erase(fd);
+    eraseChannel(fd);
 
     LOG_DEBUG("%s:%s:%d => socket fd=%d's channel will remove.", __FILENAME__, __FUNCTION__, __LINE__, fd);
 
@@ -82,6 +87,10 @@ void EPollPoller::removeChannel(Channel *channel) {
     channel->set_index(kNew);
 }
 
+bool EPollPoller::edgeTriggeredSupported() const {
+    return true;
+}
+
 void EPollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const {
     for(int i = 0; i < numEvents; i++) {
         Channel *channel = static_cast<Channel*>(events_[i].data.ptr);
@@ -95,11 +104,13 @@ void EPollPoller::update(int operation, Channel *channel) {
     memset(&event, 0, sizeof event);
 
     int fd = channel->fd();
-    event.events = channel->events();
+    event.events = channel->pollEvents();
     event.data.fd = fd; 
     event.data.ptr = channel;
 
-    if(epoll_ctl(epollfd_, operation, fd, &event) < 0) {
+    if(epoll_ctl(epollfd_, operation, fd, &event) == 0)
+        channel->set_registeredEvents(operation == EPOLL_CTL_DEL ? kNoneEvents : event.events);
+    else {
         if(operation == EPOLL_CTL_DEL)
             LOG_ERROR("%s:%s:%d => socket fd=%d's EPOLL_CTL_DEL fail, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, fd, errno);
         else
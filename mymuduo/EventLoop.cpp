@@ -3,11 +3,12 @@
 #include "CurrentThread.h"
 #include "Logger.h"
 #include "Poller.h"
+#include "TimerQueue.h"
 
 #include <cerrno>
+#include <chrono>
 #include <cstdint>
 #include <memory>
-#include <mutex>
 #include <sys/eventfd.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -16,6 +17,28 @@
 __thread EventLoop *t_loopInThisThread = nullptr;
 
 const int kPollTimeMs = 10000;
+// run nodes a loop keeps for reuse, beyond that they are freed. a burst larger than this allocates again
+const size_t kMaxFreeFunctors = 4096;
+
+struct PendingFunctor: MpscNode {
+    EventLoop::Functor functor;
+    PendingFunctor *nextFree;
+};
+
+// nodes this thread took from a loop's free list, reused by its next queueInLoop on any loop
+struct FunctorCache {
+    ~FunctorCache() {
+        while(head) {
+            PendingFunctor *next = head->nextFree;
+            delete head;
+            head = next;
+        }
+    }
+
+    PendingFunctor *head = nullptr;
+};
+
+static thread_local FunctorCache t_functorCache;
 
 static int createEventfd() {
     int evtfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
@@ -24,14 +47,31 @@ static int createEventfd() {
     return evtfd;
 }
 
-EventLoop::EventLoop():
+Poller* EventLoop::newPoller(const std::string &pollerName, EventLoop *loop) {
+    if(pollerName.empty())
+        return Poller::newDefaultPoller(loop);
+    Poller *poller = Poller::newPoller(pollerName, loop);
+    if(poller == nullptr)
+        LOG_FATAL("%s:%s:%d => no poller named %s, eventloop create fail, exit.", __FILENAME__, __FUNCTION__, __LINE__, pollerName.c_str());
+    return poller;
+}
+
+EventLoop::EventLoop(): EventLoop(std::string()) {}
+
+EventLoop::EventLoop(const std::string &pollerName):
     looping_(false),
     quit_(false),
-    callingPendingFunctors_(false),
     threadId_(CurrentThread::tid()),
-    poller_(Poller::newDefaultPoller(this)),
+    poller_(newPoller(pollerName, this)),
+    timerQueue_(new TimerQueue(this)),
     wakeupFd_(createEventfd()),
-    wakeupChannel_(new Channel(this, wakeupFd_)) {
+    wakeupChannel_(new Channel(this, wakeupFd_)),
+    pendingCount_(0),
+    freeFunctors_(nullptr),
+    freeCount_(0),
+    busyPollMicros_(0),
+    spinning_(false),
+    connectionCount_(0) {
     
     LOG_INFO("%s:%s:%d => eventloop=%p create in thread=%d.", __FILENAME__, __FUNCTION__, __LINE__, this, threadId_);
     if(t_loopInThisThread)
@@ -47,6 +87,16 @@ EventLoop::~EventLoop() {
     wakeupChannel_->disableAll();
     wakeupChannel_->remove();
     close(wakeupFd_);
+
+    while(MpscNode *node = pendingFunctors_.pop()) {
+        delete static_cast<PendingFunctor*>(node);
+    }
+    PendingFunctor *node = freeFunctors_.exchange(nullptr);
+    while(node) {
+        PendingFunctor *next = node->nextFree;
+        delete node;
+        node = next;
+    }
     t_loopInThisThread = nullptr;
 }
 
@@ -58,7 +108,8 @@ void EventLoop::loop() {
 
     while(!quit_) {
         activeChannel_.clear();
-        pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannel_);
+        pollReturnTime_ = pollOnce();
+        pollReturnMonotonic_ = Timestamp::monotonicNow();
         for(Channel *channel: activeChannel_) {
             channel->handleEvent(pollReturnTime_);
         }
@@ -80,20 +131,37 @@ Timestamp EventLoop::pollReturnTime() const {
     return pollReturnTime_;
 }
 
+Timestamp EventLoop::cachedNow() const {
+    return pollReturnTime_;
+}
+
+Timestamp EventLoop::cachedMonotonicNow() const {
+    return pollReturnMonotonic_;
+}
+
 void EventLoop::runInLoop(Functor cb) {
     if(isInLoopThread())
         cb();
     else
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
 }
 
 void EventLoop::queueInLoop(Functor cb) {
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
-    }
-
-    if(!isInLoopThread() || callingPendingFunctors_)
+    FunctorCache &cache = t_functorCache;
+    if(cache.head == nullptr)
+        cache.head = freeFunctors_.exchange(nullptr, std::memory_order_acquire);
+    PendingFunctor *node = cache.head;
+    if(node)
+        cache.head = node->nextFree;
+    else
+        node = new PendingFunctor;
+    node->functor = std::move(cb);
+    pendingFunctors_.push(node);
+
+    // a non-empty queue already has a wakeup on the way, or is being drained and rechecked by doPendingFunctors.
+    // in the loop thread the queue is drained right after the current events anyway.
+    // a spinning loop checks the queue itself.
+    if(pendingCount_.fetch_add(1) == 0 && !isInLoopThread() && !spinning_.load())
         wakeup();
 }
 
@@ -104,6 +172,34 @@ void EventLoop::wakeup() {
         LOG_ERROR("%s:%s:%d => thread=%d's eventloop=%p wakeup write %ldB, not 8B.", __FILENAME__, __FUNCTION__, __LINE__, threadId_, this, n);
 }
 
+void EventLoop::setBusyPollMicros(int micros) {
+    busyPollMicros_.store(micros > 0 ? micros : 0, std::memory_order_relaxed);
+}
+
+int EventLoop::busyPollMicros() const {
+    return busyPollMicros_.load(std::memory_order_relaxed);
+}
+
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb) {
+    int64_t fromNow = time.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
+    Timestamp when(Timestamp::monotonicNow().microSecondsSinceEpoch() + fromNow);
+    return timerQueue_->addTimer(std::move(cb), when, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb) {
+    Timestamp when(addTime(Timestamp::monotonicNow(), delay));
+    return timerQueue_->addTimer(std::move(cb), when, 0.0);
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb) {
+    Timestamp when(addTime(Timestamp::monotonicNow(), interval));
+    return timerQueue_->addTimer(std::move(cb), when, interval);
+}
+
+void EventLoop::cancel(TimerId timerId) {
+    timerQueue_->cancel(timerId);
+}
+
 void EventLoop::updateChannel(Channel *channel) {
     poller_->updateChannel(channel);
 }
@@ -116,10 +212,46 @@ bool EventLoop::hasChannel(Channel *channel) {
     return poller_->hasChannel(channel);
 }
 
+bool EventLoop::edgeTriggeredSupported() const {
+    return poller_->edgeTriggeredSupported();
+}
+
+bool EventLoop::attachIoBuffers(Channel *channel) {
+    return poller_->attachIoBuffers(channel);
+}
+
+bool EventLoop::startRead(Channel *channel) {
+    return poller_->startRead(channel);
+}
+
+ssize_t EventLoop::finishRead(Channel *channel, Buffer *buf) {
+    return poller_->finishRead(channel, buf);
+}
+
+size_t EventLoop::startWrite(Channel *channel, const iovec *iov, int iovcnt) {
+    return poller_->startWrite(channel, iov, iovcnt);
+}
+
+ssize_t EventLoop::finishWrite(Channel *channel) {
+    return poller_->finishWrite(channel);
+}
+
 bool EventLoop::isInLoopThread() const {
     return threadId_ == CurrentThread::tid();
 }
 
+int EventLoop::connectionCount() const {
+    return connectionCount_.load(std::memory_order_relaxed);
+}
+
+void EventLoop::adjustConnectionCount(int delta) {
+    connectionCount_.fetch_add(delta, std::memory_order_relaxed);
+}
+
+size_t EventLoop::queueSize() const {
+    return pendingCount_.load(std::memory_order_relaxed);
+}
+
 void EventLoop::handleRead() {
     uint64_t one = 1;
     ssize_t n = read(wakeupFd_, &one, sizeof one);
@@ -127,22 +259,64 @@ void EventLoop::handleRead() {
         LOG_ERROR("%s:%s:%d => thread=%d's eventloop=%p wakeup read %ldB, not 8B", __FILENAME__, __FUNCTION__, __LINE__, threadId_, this, n);
 }
 
-void EventLoop::doPendingFunctors() {
-    std::vector<Functor> functors;
-    callingPendingFunctors_ = true;
-
-    {
-        std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_);
+Timestamp EventLoop::pollOnce() {
+    const int spinMicros = busyPollMicros_.load(std::memory_order_relaxed);
+    if(spinMicros > 0) {
+        spinning_.store(true);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(spinMicros);
+        do {
+            Timestamp now = poller_->poll(0, &activeChannel_);
+            if(!activeChannel_.empty() || pendingCount_.load() > 0 || quit_) {
+                spinning_.store(false);
+                return now;
+            }
+        } while(std::chrono::steady_clock::now() < deadline);
+        spinning_.store(false);
     }
 
-    for(const Functor &functor: functors) {
-        functor();
-    }
+    // both sides are seq_cst: a producer either sees spinning_ cleared and writes wakeupFd_,
+    // or its functor is counted here and we do not block. this also covers functors queued from
+    // this thread before loop() started, which never wake anyone.
+    return poller_->poll(pendingCount_.load() > 0 ? 0 : kPollTimeMs, &activeChannel_);
+}
 
-    callingPendingFunctors_ = false;
+void EventLoop::doPendingFunctors() {
+    // only run what was queued before we started, functors queueing more are picked up next iteration
+    size_t count = pendingCount_.load();
+    if(count == 0)
+        return;
+
+    size_t done = 0;
+    while(done < count) {
+        PendingFunctor *node = static_cast<PendingFunctor*>(pendingFunctors_.pop());
+        if(node == nullptr)
+            break;
+        node->functor();
+        recycleFunctor(node);
+        done++;
+    }
 
+    // anything queued meanwhile saw a non-empty queue and did not wake us, so do it on their behalf
+    if(pendingCount_.fetch_sub(done) != done)
+        wakeup();
 }
 
+void EventLoop::recycleFunctor(PendingFunctor *node) {
+    // release what the task captured now, not when the node is reused
+    node->functor = nullptr;
+
+    // empty means a producer took everything since we last pushed
+    PendingFunctor *head = freeFunctors_.load(std::memory_order_relaxed);
+    if(head == nullptr)
+        freeCount_ = 0;
+    if(freeCount_ >= kMaxFreeFunctors) {
+        delete node;
+        return;
+    }
 
-
+    // only a producer's exchange can get in between, which leaves the stack empty
+    do {
+        node->nextFree = head;
+    } while(!freeFunctors_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+    freeCount_ = head == nullptr ? 1 : freeCount_ + 1;
+}
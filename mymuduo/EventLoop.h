@@ -1,48 +1,94 @@
 #pragma once
 
-#include "Timestamp.h"
+#include "Callbacks.h"
+#include "InlineFunction.h"
+#include "MpscQueue.h"
 #include "noncopyable.h"
+#include "TimerId.h"
+#include "Timestamp.h"
 
 #include <atomic>
 #include <functional>
 #include <memory>
-#include <mutex>
+#include <string>
 #include <unistd.h>
 #include <vector>
 
 
+class Buffer;
 class Channel;
 class Poller;
+class TimerQueue;
+struct iovec;
+struct PendingFunctor;
 
 class EventLoop: noncopyable {
 public:
-    using Functor = std::function<void()>;
+    using Functor = InlineFunction<void()>;
 private:
     using ChannelList = std::vector<Channel*>;
 
 public:
     EventLoop();
+    // with a backend registered under pollerName (see Poller::registerPoller), fatal if there is none
+    explicit EventLoop(const std::string &pollerName);
     ~EventLoop();
 
     void loop();
     void quit();
 
     Timestamp pollReturnTime() const;
+    // clocks cached once per iteration when poll() returns, for cheap reads from callbacks on this loop's
+    // thread. they lag the real clock by however long the iteration has been running.
+    // cachedNow() is the wall clock, the same as pollReturnTime(); cachedMonotonicNow() is CLOCK_MONOTONIC
+    Timestamp cachedNow() const;
+    Timestamp cachedMonotonicNow() const;
 
     void runInLoop(Functor cb);
     void queueInLoop(Functor cb);
 
     void wakeup();
 
+    // busy polling for latency-critical loops: before blocking, poll with a zero timeout for up to
+    // micros microseconds. while the loop spins, queueInLoop from other threads skips the eventfd write
+    // and the functor is picked up by the next spin. 0, the default, always blocks. thread safe
+    void setBusyPollMicros(int micros);
+    int busyPollMicros() const;
+
+    // timers, thread safe. they run on the monotonic clock, runAt converts from the wall clock once,
+    // so stepping the system clock afterwards neither fires nor delays them
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    TimerId runAfter(double delay, TimerCallback cb);
+    TimerId runEvery(double interval, TimerCallback cb);
+    void cancel(TimerId timerId);
+
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
     bool hasChannel(Channel *channel);
+    bool edgeTriggeredSupported() const;
+
+    // completion-based IO for TcpConnection, see Poller::attachIoBuffers. readiness backends attach nothing
+    bool attachIoBuffers(Channel *channel);
+    bool startRead(Channel *channel);
+    ssize_t finishRead(Channel *channel, Buffer *buf);
+    size_t startWrite(Channel *channel, const iovec *iov, int iovcnt);
+    ssize_t finishWrite(Channel *channel);
 
     bool isInLoopThread() const;
 
+    // load metrics for EventLoopThreadPool's distribution policies, relaxed, readable from any thread.
+    // TcpConnection counts itself from construction until connectDestroyed
+    int connectionCount() const;
+    void adjustConnectionCount(int delta);
+    // functors queued and not run yet
+    size_t queueSize() const;
+
 private:
+    static Poller* newPoller(const std::string &pollerName, EventLoop *loop);
     void handleRead();
     void doPendingFunctors();
+    void recycleFunctor(PendingFunctor *node);
+    Timestamp pollOnce();
 
 private:
     std::atomic_bool looping_;
@@ -50,16 +96,30 @@ private:
     const pid_t threadId_;
 
     Timestamp pollReturnTime_;
+    Timestamp pollReturnMonotonic_;
     std::unique_ptr<Poller> poller_;
+    std::unique_ptr<TimerQueue> timerQueue_;
 
     int wakeupFd_;
     std::unique_ptr<Channel> wakeupChannel_;
 
     ChannelList activeChannel_;
 
-    std::atomic_bool callingPendingFunctors_;
-    std::vector<Functor> pendingFunctors_;
-    std::mutex mutex_;
+    // lock-free queue of PendingFunctor nodes, pendingCount_ lets only the producer
+    // that makes it non-empty write to wakeupFd_
+    MpscQueue pendingFunctors_;
+    std::atomic<size_t> pendingCount_;
+    // nodes that have run, pushed only by this loop's thread. a producer takes the whole stack at once into
+    // its thread's cache, so popping needs no CAS and has no ABA. freeCount_ is this thread's estimate of its size
+    std::atomic<PendingFunctor*> freeFunctors_;
+    size_t freeCount_;
+
+    std::atomic_int busyPollMicros_;
+    // set while spinning, producers seeing it skip the wakeup. cleared before blocking, after which
+    // pendingCount_ is checked again so a functor queued in between is not left waiting
+    std::atomic_bool spinning_;
+
+    std::atomic_int connectionCount_;
 };
 
 
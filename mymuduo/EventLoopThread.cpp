@@ -22,6 +22,10 @@ EventLoopThread::~EventLoopThread() {
     }
 }
 
+void EventLoopThread::setThreadStartCallback(const ThreadStartCallback &cb) {
+    startCallback_ = cb;
+}
+
 EventLoop* EventLoopThread::startLoop() {
     thread_.start();
     EventLoop *loop = nullptr;
@@ -37,6 +41,9 @@ EventLoop* EventLoopThread::startLoop() {
 }
 
 void EventLoopThread::threadFunc() {
+    if(startCallback_)
+        startCallback_();
+
     EventLoop loop;
     if(callback_)
         callback_(&loop);
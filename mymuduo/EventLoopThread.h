@@ -14,10 +14,14 @@ class EventLoop;
 class EventLoopThread: noncopyable {
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
+    using ThreadStartCallback = std::function<void()>;
 
     EventLoopThread(const ThreadInitCallback &cb = ThreadInitCallback(), const std::string &name = std::string());
     ~EventLoopThread();
 
+    // runs first thing in the new thread, before the EventLoop exists, e.g. to pin it. set before startLoop
+    void setThreadStartCallback(const ThreadStartCallback &cb);
+
     EventLoop* startLoop();
 
 private:
@@ -30,6 +34,7 @@ private:
     std::mutex mutex_;
     std::condition_variable cond_;
     ThreadInitCallback callback_;
+    ThreadStartCallback startCallback_;
 };
 
 
@@ -1,6 +1,9 @@
 #include "EventLoopThreadPool.h"
+#include "EventLoop.h"
 #include "EventLoopThread.h"
+#include "InetAddress.h"
 
+#include <arpa/inet.h>
 #include <cstdio>
 #include <memory>
 #include <string>
@@ -12,7 +15,9 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string
     name_(nameArg),
     started_(false),
     numThreads_(0),
-    next_(0) {}
+    next_(0),
+    distribution_(kRoundRobin),
+    random_(2463534242u) {}
 
 EventLoopThreadPool::~EventLoopThreadPool() {}
 
@@ -20,6 +25,10 @@ void EventLoopThreadPool::setThreadNum(int numThreads) {
     numThreads_ = numThreads;
 }
 
+void EventLoopThreadPool::setPlacement(const CpuPlacement &placement) {
+    placement_ = placement;
+}
+
 void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
     started_ = true;
 
@@ -27,6 +36,10 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
         EventLoopThread *t = new EventLoopThread(cb, buf);
+        if(placement_.policy() != CpuPlacement::kNone) {
+            CpuPlacement::Slot slot = placement_.slot(i);
+            t->setThreadStartCallback([slot]() { CpuPlacement::apply(slot); });
+        }
         threads_.push_back(std::unique_ptr<EventLoopThread>(t));
         loops_.push_back(t->startLoop());
     }
@@ -35,18 +48,80 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb) {
         cb(baseLoop_);
 }
 
+void EventLoopThreadPool::setDistribution(Distribution distribution) {
+    distribution_ = distribution;
+}
+
 EventLoop* EventLoopThreadPool::getNextLoop() {
-    EventLoop *loop = baseLoop_;
+    if(loops_.empty())
+        return baseLoop_;
 
-    if(!loops_.empty()) {
-        loop = loops_[next_];
-        next_++;
-        if(next_ >= loops_.size())
-            next_ = 0;
+    switch(distribution_) {
+    case kLeastConnections:
+        return leastConnectionsLoop();
+    case kPowerOfTwoChoices:
+        return powerOfTwoChoicesLoop();
+    default:
+        return roundRobinLoop();
     }
+}
+
+EventLoop* EventLoopThreadPool::getNextLoop(const InetAddress &peerAddr) {
+    if(loops_.empty() || distribution_ != kHashByPeer)
+        return getNextLoop();
+
+    // fibonacci hashing spreads consecutive addresses, the high bits then scale onto the loops
+    uint32_t ip = ntohl(peerAddr.getSockAddr()->sin_addr.s_addr);
+    uint32_t hash = ip * 2654435769u;
+    return loops_[(static_cast<uint64_t>(hash) * loops_.size()) >> 32];
+}
+
+EventLoop* EventLoopThreadPool::roundRobinLoop() {
+    EventLoop *loop = loops_[next_];
+    next_++;
+    if(next_ >= loops_.size())
+        next_ = 0;
     return loop;
 }
 
+EventLoop* EventLoopThreadPool::leastConnectionsLoop() {
+    // start where round robin stands, so ties rotate instead of all going to the first loop
+    EventLoop *best = roundRobinLoop();
+    int bestCount = best->connectionCount();
+    for(size_t i = 1; i < loops_.size() && bestCount > 0; i++) {
+        EventLoop *loop = loops_[(next_ + i - 1) % loops_.size()];
+        int count = loop->connectionCount();
+        if(count < bestCount) {
+            best = loop;
+            bestCount = count;
+        }
+    }
+    return best;
+}
+
+EventLoop* EventLoopThreadPool::powerOfTwoChoicesLoop() {
+    if(loops_.size() == 1)
+        return loops_[0];
+
+    // xorshift32, only the accepting thread draws from it
+    auto next = [this]() {
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        return random_;
+    };
+    size_t a = next() % loops_.size();
+    size_t b = (a + 1 + next() % (loops_.size() - 1)) % loops_.size();
+    EventLoop *first = loops_[a];
+    EventLoop *second = loops_[b];
+
+    int firstCount = first->connectionCount();
+    int secondCount = second->connectionCount();
+    if(firstCount != secondCount)
+        return firstCount < secondCount ? first : second;
+    return first->queueSize() <= second->queueSize() ? first : second;
+}
+
 std::vector<EventLoop*> EventLoopThreadPool::getAllLoops() {
     if(loops_.empty())
         return std::vector<EventLoop*>(1, baseLoop_);
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "CpuPlacement.h"
 #include "noncopyable.h"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -10,29 +12,54 @@
 
 class EventLoop;
 class EventLoopThread;
+class InetAddress;
 
 class EventLoopThreadPool: noncopyable {
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 
+    // how getNextLoop picks the loop for a new connection
+    enum Distribution {
+        kRoundRobin,
+        // fewest live connections, scans every loop
+        kLeastConnections,
+        // the less loaded of two random loops, by connections then queued functors
+        kPowerOfTwoChoices,
+        // same peer ip, same loop. falls back to round robin without a peer address
+        kHashByPeer,
+    };
+
     EventLoopThreadPool(EventLoop *baseLoop, const std::string &nameArg);
     ~EventLoopThreadPool();
 
     void setThreadNum(int numThreads);
+    // where the io loop threads run, io loop i takes placement.slot(i). set before start
+    void setPlacement(const CpuPlacement &placement);
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
 
-    EventLoop* getNextLoop(); 
+    // not thread safe, called from the thread that accepts, i.e. the base loop
+    void setDistribution(Distribution distribution);
+    EventLoop* getNextLoop();
+    EventLoop* getNextLoop(const InetAddress &peerAddr);
     std::vector<EventLoop*> getAllLoops();
 
     bool started() const;
     const std::string name() const;
 
+private:
+    EventLoop* roundRobinLoop();
+    EventLoop* leastConnectionsLoop();
+    EventLoop* powerOfTwoChoicesLoop();
+
 private:
     EventLoop *baseLoop_;
     std::string name_;
     bool started_;
     int numThreads_;
     int next_;
+    CpuPlacement placement_;
+    Distribution distribution_;
+    uint32_t random_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;
 };
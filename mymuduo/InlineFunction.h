@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+// move-only replacement for std::function with a larger inline buffer.
+// the tasks the event loop queues, typically a bound member function with a shared_ptr and a few arguments,
+// are stored in place and never touch the heap. bigger or throwing-move callables fall back to one allocation.
+template<typename Signature, size_t InlineSize = 80>
+class InlineFunction;
+
+template<typename R, typename... Args, size_t InlineSize>
+class InlineFunction<R(Args...), InlineSize> {
+public:
+    InlineFunction() noexcept: ops_(nullptr) {}
+    InlineFunction(std::nullptr_t) noexcept: ops_(nullptr) {}
+
+    template<typename F, typename = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+    InlineFunction(F &&f): ops_(nullptr) {
+        using Callable = typename std::decay<F>::type;
+        if(isNull(f))
+            return;
+        if(fitsInline<Callable>()) {
+            new (storage_) Callable(std::forward<F>(f));
+            ops_ = &InlineOps<Callable>::ops;
+        }
+        else {
+            *reinterpret_cast<Callable**>(storage_) = new Callable(std::forward<F>(f));
+            ops_ = &HeapOps<Callable>::ops;
+        }
+    }
+
+    InlineFunction(InlineFunction &&rhs) noexcept: ops_(rhs.ops_) {
+        if(ops_) {
+            ops_->move(storage_, rhs.storage_);
+            rhs.ops_ = nullptr;
+        }
+    }
+
+    InlineFunction& operator=(InlineFunction &&rhs) noexcept {
+        if(this != &rhs) {
+            reset();
+            ops_ = rhs.ops_;
+            if(ops_) {
+                ops_->move(storage_, rhs.storage_);
+                rhs.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction&) = delete;
+    InlineFunction& operator=(const InlineFunction&) = delete;
+
+    ~InlineFunction() {
+        reset();
+    }
+
+    R operator()(Args... args) const {
+        return ops_->invoke(storage_, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept {
+        return ops_ != nullptr;
+    }
+
+private:
+    struct Ops {
+        R (*invoke)(void *storage, Args&&... args);
+        // move-constructs into dst and destroys src
+        void (*move)(void *dst, void *src);
+        void (*destroy)(void *storage);
+    };
+
+    template<typename Callable>
+    struct InlineOps {
+        static R invoke(void *storage, Args&&... args) {
+            return (*static_cast<Callable*>(storage))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src) {
+            new (dst) Callable(std::move(*static_cast<Callable*>(src)));
+            static_cast<Callable*>(src)->~Callable();
+        }
+        static void destroy(void *storage) {
+            static_cast<Callable*>(storage)->~Callable();
+        }
+        static constexpr Ops ops = {&invoke, &move, &destroy};
+    };
+
+    template<typename Callable>
+    struct HeapOps {
+        static R invoke(void *storage, Args&&... args) {
+            return (**static_cast<Callable**>(storage))(std::forward<Args>(args)...);
+        }
+        static void move(void *dst, void *src) {
+            *static_cast<Callable**>(dst) = *static_cast<Callable**>(src);
+        }
+        static void destroy(void *storage) {
+            delete *static_cast<Callable**>(storage);
+        }
+        static constexpr Ops ops = {&invoke, &move, &destroy};
+    };
+
+    template<typename Callable>
+    static constexpr bool fitsInline() {
+        return sizeof(Callable) <= InlineSize
+            && alignof(Callable) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible<Callable>::value;
+    }
+
+    template<typename T>
+    static bool isNull(const T&) {
+        return false;
+    }
+
+    template<typename T>
+    static bool isNull(T *ptr) {
+        return ptr == nullptr;
+    }
+
+    template<typename Sig>
+    static bool isNull(const std::function<Sig> &func) {
+        return !func;
+    }
+
+    void reset() {
+        if(ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    alignas(std::max_align_t) mutable unsigned char storage_[InlineSize];
+    const Ops *ops_;
+};
+
+template<typename R, typename... Args, size_t InlineSize>
+template<typename Callable>
+constexpr typename InlineFunction<R(Args...), InlineSize>::Ops InlineFunction<R(Args...), InlineSize>::InlineOps<Callable>::ops;
+
+template<typename R, typename... Args, size_t InlineSize>
+template<typename Callable>
+constexpr typename InlineFunction<R(Args...), InlineSize>::Ops InlineFunction<R(Args...), InlineSize>::HeapOps<Callable>::ops;
+
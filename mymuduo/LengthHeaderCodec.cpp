@@ -0,0 +1,48 @@
+#include "LengthHeaderCodec.h"
+#include "Buffer.h"
+#include "Logger.h"
+#include "TcpConnection.h"
+#include "Timestamp.h"
+
+#include <utility>
+
+
+LengthHeaderCodec::LengthHeaderCodec(const FrameCallback &cb, size_t maxFrameBytes):
+    frameCallback_(cb),
+    maxFrameBytes_(maxFrameBytes) {}
+
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+    while(buf->readableBytes() >= kHeaderLen) {
+        const int32_t len = buf->peekInt32();
+        if(len < 0 || static_cast<size_t>(len) > maxFrameBytes_) {
+            LOG_ERROR("%s:%s:%d => TcpConnection=%s invalid frame length %d, close.", __FILENAME__, __FUNCTION__, __LINE__, conn->name().c_str(), len);
+            buf->retrieveAll();
+            conn->forceClose();
+            break;
+        }
+        if(buf->readableBytes() < kHeaderLen + len)
+            break;
+
+        frameCallback_(conn, buf->peek() + kHeaderLen, len, receiveTime);
+        buf->retrieve(kHeaderLen + len);
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, Buffer &&payload) {
+    encode(&payload);
+    conn->send(std::move(payload));
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const char *data, size_t len) {
+    Buffer frame(len);
+    frame.append(data, len);
+    send(conn, std::move(frame));
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const std::string &message) {
+    send(conn, message.data(), message.size());
+}
+
+void LengthHeaderCodec::encode(Buffer *payload) {
+    payload->prependInt32(static_cast<int32_t>(payload->readableBytes()));
+}
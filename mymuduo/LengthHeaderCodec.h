@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Callbacks.h"
+#include "noncopyable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+
+// frames of a 4 byte big-endian payload length followed by the payload. plug onMessage in as the
+// connection's message callback: every complete frame in the input buffer is handed to the frame
+// callback in place, a partial one waits for more data. a length below 0 or above maxFrameBytes
+// means the stream is corrupt and the connection is closed.
+// outbound, the header goes into the payload buffer's prepend area, so framing copies nothing.
+class LengthHeaderCodec: noncopyable {
+public:
+    // payload points into the input buffer and is only valid during the call
+    using FrameCallback = std::function<void(const TcpConnectionPtr&, const char *payload, size_t len, Timestamp)>;
+
+    explicit LengthHeaderCodec(const FrameCallback &cb, size_t maxFrameBytes = kDefaultMaxFrameBytes);
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+    // payload holds the message as its readable bytes, the header is prepended in place
+    void send(const TcpConnectionPtr &conn, Buffer &&payload);
+    void send(const TcpConnectionPtr &conn, const char *data, size_t len);
+    void send(const TcpConnectionPtr &conn, const std::string &message);
+
+    // turn the readable bytes of payload into one frame
+    static void encode(Buffer *payload);
+
+public:
+    static const size_t kHeaderLen = sizeof(int32_t);
+    static const size_t kDefaultMaxFrameBytes = 64 * 1024 * 1024;
+
+private:
+    FrameCallback frameCallback_;
+    const size_t maxFrameBytes_;
+};
@@ -0,0 +1,94 @@
+#include "LogFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+
+LogFile::LogFile(const std::string &basename, off_t rollSize):
+    basename_(basename),
+    rollSize_(rollSize),
+    fp_(nullptr),
+    writtenBytes_(0),
+    startOfPeriod_(0),
+    lastRoll_(0) {
+
+    rollFile();
+}
+
+LogFile::~LogFile() {
+    if(fp_)
+        fclose(fp_);
+}
+
+void LogFile::append(const char *logline, size_t len) {
+    if(fp_ == nullptr)
+        return;
+
+    size_t written = 0;
+    while(written < len) {
+        size_t n = fwrite_unlocked(logline + written, 1, len - written, fp_);
+        if(n == 0) {
+            fprintf(stderr, "LogFile::append() failed, errno=%d.\n", ferror(fp_) ? errno : 0);
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+
+    if(writtenBytes_ > rollSize_)
+        rollFile();
+    else {
+        time_t now = time(nullptr);
+        if(now / kRollPerSeconds * kRollPerSeconds != startOfPeriod_)
+            rollFile();
+    }
+}
+
+void LogFile::flush() {
+    if(fp_)
+        fflush(fp_);
+}
+
+void LogFile::rollFile() {
+    time_t now = 0;
+    std::string filename = getLogFileName(basename_, &now);
+    // never roll twice within a second, the new file would get the same name
+    if(now <= lastRoll_)
+        return;
+
+    if(fp_)
+        fclose(fp_);
+    fp_ = fopen(filename.c_str(), "ae");
+    if(fp_ == nullptr)
+        fprintf(stderr, "LogFile::rollFile() open %s failed, errno=%d.\n", filename.c_str(), errno);
+    else
+        setbuffer(fp_, buffer_, sizeof buffer_);
+
+    writtenBytes_ = 0;
+    lastRoll_ = now;
+    startOfPeriod_ = now / kRollPerSeconds * kRollPerSeconds;
+}
+
+std::string LogFile::getLogFileName(const std::string &basename, time_t *now) {
+    std::string filename(basename);
+
+    char timebuf[32];
+    tm tm_time;
+    *now = time(nullptr);
+    localtime_r(now, &tm_time);
+    strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm_time);
+    filename += timebuf;
+
+    char hostname[256] = {0};
+    if(gethostname(hostname, sizeof hostname - 1) != 0)
+        strcpy(hostname, "unknownhost");
+    filename += hostname;
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d.log", getpid());
+    filename += pidbuf;
+
+    return filename;
+}
+
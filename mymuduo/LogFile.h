@@ -0,0 +1,37 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <sys/types.h>
+
+
+// append-only log file that rolls over to a new file after rollSize bytes or at midnight.
+// not thread safe, meant to be written by a single AsyncLogging backend thread.
+class LogFile: noncopyable {
+public:
+    LogFile(const std::string &basename, off_t rollSize);
+    ~LogFile();
+
+    void append(const char *logline, size_t len);
+    void flush();
+    void rollFile();
+
+private:
+    static std::string getLogFileName(const std::string &basename, time_t *now);
+
+private:
+    static const int kRollPerSeconds = 60 * 60 * 24;
+
+    const std::string basename_;
+    const off_t rollSize_;
+
+    FILE *fp_;
+    off_t writtenBytes_;
+    time_t startOfPeriod_;
+    time_t lastRoll_;
+    char buffer_[64 * 1024];
+};
+
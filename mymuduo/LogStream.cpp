@@ -0,0 +1,134 @@
+#include "LogStream.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+
+LogStream::LogStream(): length_(0) {}
+
+LogStream& LogStream::operator<<(bool v) {
+    append(v ? "1" : "0", 1);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(char v) {
+    append(&v, 1);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(int v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned int v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(long v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned long v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(long long v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(unsigned long long v) {
+    formatInteger(v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(double v) {
+    if(avail() > 32)
+        length_ += snprintf(buffer_ + length_, 32, "%.12g", v);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(const void *p) {
+    if(avail() > 32)
+        length_ += snprintf(buffer_ + length_, 32, "%p", p);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(const char *str) {
+    if(str)
+        append(str, strlen(str));
+    else
+        append("(null)", 6);
+    return *this;
+}
+
+LogStream& LogStream::operator<<(const std::string &str) {
+    append(str.data(), str.size());
+    return *this;
+}
+
+void LogStream::append(const char *data, size_t len) {
+    len = std::min(len, avail());
+    memcpy(buffer_ + length_, data, len);
+    length_ += len;
+}
+
+const char* LogStream::data() const {
+    return buffer_;
+}
+
+size_t LogStream::length() const {
+    return length_;
+}
+
+size_t LogStream::avail() const {
+    return sizeof buffer_ - length_;
+}
+
+template<typename T>
+void LogStream::formatInteger(T v) {
+    // enough for 64-bit values and a sign
+    char digits[24];
+    char *p = digits + sizeof digits;
+    bool negative = v < 0;
+    do {
+        int d = static_cast<int>(v % 10);
+        *--p = static_cast<char>('0' + (d < 0 ? -d : d));
+        v /= 10;
+    } while(v != 0);
+    if(negative)
+        *--p = '-';
+    append(p, digits + sizeof digits - p);
+}
+
+LogMessage::LogMessage(int level, const char *file, int line): level_(level) {
+    char prefix[128];
+    size_t n = Logger::formatPrefix(level, prefix, sizeof prefix);
+    stream_.append(prefix, n);
+    stream_ << file << ':' << line << " => ";
+}
+
+LogMessage::~LogMessage() {
+    // keep the last byte for the newline even when the message was truncated
+    size_t len = std::min(stream_.length(), static_cast<size_t>(LogStream::kMaxLineSize - 1));
+    char *line = const_cast<char*>(stream_.data());
+    line[len++] = '\n';
+    Logger::instance().output(level_, line, len);
+
+    if(level_ == Logger::FATAL)
+        exit(-1);
+}
+
+LogStream& LogMessage::stream() {
+    return stream_;
+}
+
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <cstddef>
+#include <string>
+
+
+// fixed-size line buffer with operator<< formatting, no allocation and no zero-filling.
+// output past kMaxLineSize is truncated.
+class LogStream: noncopyable {
+public:
+    LogStream();
+
+    LogStream& operator<<(bool v);
+    LogStream& operator<<(char v);
+    LogStream& operator<<(int v);
+    LogStream& operator<<(unsigned int v);
+    LogStream& operator<<(long v);
+    LogStream& operator<<(unsigned long v);
+    LogStream& operator<<(long long v);
+    LogStream& operator<<(unsigned long long v);
+    LogStream& operator<<(double v);
+    LogStream& operator<<(const void *p);
+    LogStream& operator<<(const char *str);
+    LogStream& operator<<(const std::string &str);
+
+    void append(const char *data, size_t len);
+
+    const char* data() const;
+    size_t length() const;
+    size_t avail() const;
+
+public:
+    static const int kMaxLineSize = 1280;
+
+private:
+    template<typename T>
+    void formatInteger(T v);
+
+private:
+    char buffer_[kMaxLineSize];
+    size_t length_;
+};
+
+// one LOG_STREAM line: writes the prefix on construction, hands the finished line to Logger on destruction
+class LogMessage: noncopyable {
+public:
+    LogMessage(int level, const char *file, int line);
+    ~LogMessage();
+
+    LogStream& stream();
+
+private:
+    const int level_;
+    LogStream stream_;
+};
+
+// lets LOG_STREAM be an expression of type void on both branches of its ?:
+struct LogVoidify {
+    void operator&(LogStream&) {}
+};
+
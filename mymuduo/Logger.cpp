@@ -1,38 +1,85 @@
 #include "Logger.h"
 #include "Timestamp.h"
 
-#include <iostream>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
 #include <string>
 
 
+static const char *kLevelNames[] = {
+    "[DEBUG] ", "[INFO] ", "[ERROR] ", "[FATAL] "
+};
+
+static int initLogLevel() {
+    return getenv("MUDUO_LOG_DEBUG") ? Logger::DEBUG : Logger::INFO;
+}
+
+static void defaultOutput(const char *msg, size_t len) {
+    fwrite(msg, 1, len, stdout);
+}
+
+static void defaultFlush() {
+    fflush(stdout);
+}
+
+std::atomic_int Logger::logLevel_(initLogLevel());
+
+Logger::Logger(): output_(defaultOutput), flush_(defaultFlush) {}
+
 Logger& Logger::instance() {
     static Logger logger;
     return logger;
 }
 
 void Logger::setLogLevel(int level) {
-    logLevel_ = level;
-}
-
-void Logger::log(std::string msg) {
-    std::string level;
-    switch(logLevel_) {
-        case INFO:
-            level = "[INFO] ";
-            break;
-        case ERROR:
-            level = "[ERROR] ";
-            break;
-        case FATAL:
-            level = "[FATAL] ";
-            break;
-        case DEBUG:
-            level = "[DEBUG] ";
-            break;
-        default:
-            break;
-    }
-
-    std::cout << level << Timestamp::now().toString() << ": " << msg << std::endl;
+    logLevel_.store(level, std::memory_order_relaxed);
+}
+
+void Logger::setOutput(OutputFunc out) {
+    output_ = out;
+}
+
+void Logger::setFlush(FlushFunc flush) {
+    flush_ = flush;
+}
+
+void Logger::log(int level, const char *msg) {
+    logf(level, "%s", msg);
+}
+
+void Logger::logf(int level, const char *fmt, ...) {
+    char line[kMaxLineSize];
+    size_t n = formatPrefix(level, line, sizeof line);
+
+    // leave room for the newline, a truncated message is still one line
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line + n, sizeof line - n - 1, fmt, args);
+    va_end(args);
+    if(len > 0)
+        n += std::min(static_cast<size_t>(len), sizeof line - n - 2);
+    line[n++] = '\n';
+
+    output(level, line, n);
+}
+
+void Logger::output(int level, const char *line, size_t len) {
+    output_(line, len);
+    if(level == FATAL)
+        flush();
+}
+
+void Logger::flush() {
+    flush_();
+}
+
+size_t Logger::formatPrefix(int level, char *buf, size_t size) {
+    int len = snprintf(buf, size, "%s", kLevelNames[level]);
+    size_t n = std::min(static_cast<size_t>(len), size - 1);
+    n += Timestamp::now().formatTo(buf + n, size - n);
+    len = snprintf(buf + n, size - n, ": ");
+    return std::min(n + static_cast<size_t>(len), size - 1);
 }
 
@@ -1,68 +1,97 @@
 #pragma once
 
+#include "LogStream.h"
 #include "noncopyable.h"
 
+#include <atomic>
+#include <cstdarg>
 #include <cstdio>
+#include <cstdlib>
 #include <string>
 #include <cstring>
 
 #define __FILENAME__ (strrchr("/" __FILE__, '/') + 1)
 
+// levels below this are compiled out entirely, e.g. -DMUDUO_COMPILE_LOG_LEVEL=1 drops LOG_DEBUG.
+// everything else stays in the binary and is filtered at runtime by Logger::setLogLevel().
+#ifndef MUDUO_COMPILE_LOG_LEVEL
+    #define MUDUO_COMPILE_LOG_LEVEL 0
+#endif
+
+// a disabled level costs this one branch, arguments are not even evaluated
+#define MUDUO_LOG_ENABLED(level) \
+    (Logger::level >= MUDUO_COMPILE_LOG_LEVEL && Logger::level >= Logger::logLevel())
+
 #define LOG_INFO(logmsgFormat, ...) \
     do { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(Logger::INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        if(MUDUO_LOG_ENABLED(INFO)) \
+            Logger::instance().logf(Logger::INFO, logmsgFormat, ##__VA_ARGS__); \
     } while(0)
 
 #define LOG_ERROR(logmsgFormat, ...) \
     do { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(Logger::ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        if(MUDUO_LOG_ENABLED(ERROR)) \
+            Logger::instance().logf(Logger::ERROR, logmsgFormat, ##__VA_ARGS__); \
     } while(0)
 
 #define LOG_FATAL(logmsgFormat, ...) \
     do { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(Logger::FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        Logger::instance().logf(Logger::FATAL, logmsgFormat, ##__VA_ARGS__); \
         exit(-1); \
     } while(0)
 
-#ifdef MUDEBUG
-    #define LOG_DEBUG(logmsgFormat, ...) \
-        do { \
-            Logger &logger = Logger::instance(); \
-            logger.setLogLevel(Logger::DEBUG); \
-            char buf[1024] = {0}; \
-            snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-            logger.log(buf); \
-        } while(0)
-#else
-    #define LOG_DEBUG(logmsgFormat, ...)
-#endif    
+#define LOG_DEBUG(logmsgFormat, ...) \
+    do { \
+        if(MUDUO_LOG_ENABLED(DEBUG)) \
+            Logger::instance().logf(Logger::DEBUG, logmsgFormat, ##__VA_ARGS__); \
+    } while(0)
+
+// stream front end, formats straight into the line buffer:
+//     LOG_STREAM(INFO) << "conn " << conn->name() << " sent " << n << " bytes";
+#define LOG_STREAM(level) \
+    !MUDUO_LOG_ENABLED(level) ? (void)0 : LogVoidify() & LogMessage(Logger::level, __FILENAME__, __LINE__).stream()
 
 
 class Logger: noncopyable {
 private:
-    Logger() {}
+    Logger();
 
 public:
+    // ordered by severity, the threshold drops everything below it
     enum LogLevel {
-        INFO, ERROR, FATAL, DEBUG
+        DEBUG, INFO, ERROR, FATAL
     };
+    using OutputFunc = void (*)(const char *msg, size_t len);
+    using FlushFunc = void (*)();
+
     static Logger& instance();
-    void setLogLevel(int level);
-    void log(std::string msg);
+
+    // INFO by default, DEBUG when the MUDUO_LOG_DEBUG environment variable is set
+    static int logLevel() {
+        return logLevel_.load(std::memory_order_relaxed);
+    }
+    static void setLogLevel(int level);
+
+    // where formatted lines go, stdout by default. set these once at startup, e.g. to an AsyncLogging
+    void setOutput(OutputFunc out);
+    void setFlush(FlushFunc flush);
+
+    void log(int level, const char *msg);
+    void logf(int level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+    // a complete line, newline included
+    void output(int level, const char *line, size_t len);
+    void flush();
+
+    // writes "[LEVEL] time: " into buf, returns its length
+    static size_t formatPrefix(int level, char *buf, size_t size);
+
+public:
+    static const int kMaxLineSize = LogStream::kMaxLineSize;
 
 private:
-    int logLevel_;
+    static std::atomic_int logLevel_;
+
+    OutputFunc output_;
+    FlushFunc flush_;
 };
 
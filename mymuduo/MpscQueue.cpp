@@ -0,0 +1,44 @@
+#include "MpscQueue.h"
+
+
+MpscQueue::MpscQueue(): head_(&stub_), tail_(&stub_) {
+    stub_.next.store(nullptr, std::memory_order_relaxed);
+}
+
+void MpscQueue::push(MpscNode *node) {
+    node->next.store(nullptr, std::memory_order_relaxed);
+    MpscNode *prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+}
+
+MpscNode* MpscQueue::pop() {
+    MpscNode *tail = tail_;
+    MpscNode *next = tail->next.load(std::memory_order_acquire);
+
+    if(tail == &stub_) {
+        if(next == nullptr)
+            return nullptr;
+        tail_ = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if(next != nullptr) {
+        tail_ = next;
+        return tail;
+    }
+
+    // tail is the last linked node, a producer may be between exchange and link
+    if(tail != head_.load(std::memory_order_acquire))
+        return nullptr;
+
+    // put the stub back behind tail so tail can be handed out
+    push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if(next != nullptr) {
+        tail_ = next;
+        return tail;
+    }
+    return nullptr;
+}
+
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+
+
+struct MpscNode {
+    std::atomic<MpscNode*> next;
+};
+
+// intrusive lock-free multi-producer single-consumer queue (Vyukov).
+// push is wait-free and may be called from any thread, pop only from the single consumer thread.
+// the queue never owns nodes, whoever pops a node frees it.
+class MpscQueue: noncopyable {
+public:
+    MpscQueue();
+
+    void push(MpscNode *node);
+    // nullptr when empty, or when the next node's producer has not finished linking it yet
+    MpscNode* pop();
+
+private:
+    alignas(64) std::atomic<MpscNode*> head_;
+    alignas(64) MpscNode *tail_;
+    MpscNode stub_;
+};
+
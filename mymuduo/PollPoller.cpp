@@ -0,0 +1,94 @@
+#include "Channel.h"
+#include "Logger.h"
+#include "PollPoller.h"
+#include "Timestamp.h"
+
+#include <cerrno>
+#include <poll.h>
+
+
+const int kNew = -1;
+
+PollPoller::PollPoller(EventLoop *loop): Poller(loop) {}
+
+PollPoller::~PollPoller() {}
+
+Timestamp PollPoller::poll(int timeoutMs, ChannelList *activeChannels) {
+    LOG_DEBUG("%s:%s:%d => poll() will wait, total fd count that be listend is %lu.", __FILENAME__, __FUNCTION__, __LINE__, numChannels());
+
+    int numEvents = ::poll(pollfds_.data(), pollfds_.size(), timeoutMs);
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if(numEvents > 0) {
+        LOG_DEBUG("%s:%s:%d => poll() return %d events.", __FILENAME__, __FUNCTION__, __LINE__, numEvents);
+        fillActiveChannels(numEvents, activeChannels);
+    }
+    else if(numEvents == 0)
+        LOG_DEBUG("%s:%s:%d => poll() timeout.", __FILENAME__, __FUNCTION__, __LINE__);
+    else {
+        if(saveErrno != EINTR) {
+            errno = saveErrno;
+            LOG_ERROR("%s:%s:%d => poll() fail, do not get event, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, errno);
+        }
+    }
+    return now;
+}
+
+// the epoll event bits Channel uses have the same values as their poll counterparts
+void PollPoller::updateChannel(Channel *channel) {
+    const int index = channel->index();
+    const int fd = channel->fd();
+    LOG_DEBUG("%s:%s:%d => socket fd=%d's channel will update event, events=%d, index=%d.", __FILENAME__, __FUNCTION__, __LINE__, fd, channel->events(), index);
+
+    if(index == kNew) {
+        pollfd pfd;
+        pfd.fd = channel->isNoneEvent() ? -fd - 1 : fd;
+        pfd.events = static_cast<short>(channel->events());
+        pfd.revents = 0;
+        pollfds_.push_back(pfd);
+        pollChannels_.push_back(channel);
+        channel->set_index(static_cast<int>(pollfds_.size()) - 1);
+        addChannel(channel);
+    }
+    else {
+        pollfd &pfd = pollfds_[index];
+        pfd.events = static_cast<short>(channel->events());
+        pfd.revents = 0;
+        // a negative fd keeps the slot but makes poll() skip it
+        pfd.fd = channel->isNoneEvent() ? -fd - 1 : fd;
+    }
+}
+
+void PollPoller::removeChannel(Channel *channel) {
+    const int fd = channel->fd();
+    eraseChannel(fd);
+
+    LOG_DEBUG("%s:%s:%d => socket fd=%d's channel will remove.", __FILENAME__, __FUNCTION__, __LINE__, fd);
+
+    // never added, e.g. a channel removed without ever being enabled, holds no slot
+    if(channel->index() == kNew)
+        return ;
+    const size_t index = static_cast<size_t>(channel->index());
+
+    if(index != pollfds_.size() - 1) {
+        pollfds_[index] = pollfds_.back();
+        pollChannels_[index] = pollChannels_.back();
+        pollChannels_[index]->set_index(static_cast<int>(index));
+    }
+    pollfds_.pop_back();
+    pollChannels_.pop_back();
+    channel->set_index(kNew);
+}
+
+void PollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const {
+    for(size_t i = 0; i < pollfds_.size() && numEvents > 0; i++) {
+        if(pollfds_[i].revents > 0) {
+            numEvents--;
+            Channel *channel = pollChannels_[i];
+            channel->set_revents(pollfds_[i].revents);
+            activeChannels->push_back(channel);
+        }
+    }
+}
+
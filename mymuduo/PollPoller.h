@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <poll.h>
+#include <vector>
+
+
+class Channel;
+
+// poll(2) backend. Channel::index() is the channel's slot in pollfds_, so update is an in-place edit
+// and remove swaps the last slot into the hole. interest changes cost no syscall at all,
+// which can beat epoll for a few hundred hot fds whose interest flips constantly. level-triggered only.
+class PollPoller: public Poller {
+private:
+    typedef std::vector<pollfd> PollFdList;
+
+public:
+    PollPoller(EventLoop *loop);
+    ~PollPoller() override;
+
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+
+private:
+    void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
+
+private:
+    PollFdList pollfds_;
+    // pollChannels_[i] owns pollfds_[i]
+    std::vector<Channel*> pollChannels_;
+};
+
@@ -1,14 +1,62 @@
 #include "Poller.h"
 #include "Channel.h"
 
+#include <algorithm>
+#include <cerrno>
 
-Poller::Poller(EventLoop *loop): ownerloop_(loop) {}
+
+Poller::Poller(EventLoop *loop): numChannels_(0), ownerloop_(loop) {}
 
 Poller::~Poller() {}
 
 bool Poller::hasChannel(Channel *channel) const {
-    auto it = channels_.find(channel->fd());
-    return it != channels_.end() && it->second == channel;
+    size_t fd = static_cast<size_t>(channel->fd());
+    return fd < channels_.size() && channels_[fd] == channel;
+}
+
+bool Poller::edgeTriggeredSupported() const {
+    return false;
+}
+
+bool Poller::attachIoBuffers(Channel*) {
+    return false;
 }
 
+bool Poller::startRead(Channel*) {
+    return false;
+}
+
+ssize_t Poller::finishRead(Channel*, Buffer*) {
+    return -EAGAIN;
+}
+
+size_t Poller::startWrite(Channel*, const iovec*, int) {
+    return 0;
+}
 
+ssize_t Poller::finishWrite(Channel*) {
+    return -EAGAIN;
+}
+
+
+
+void Poller::addChannel(Channel *channel) {
+    size_t fd = static_cast<size_t>(channel->fd());
+    if(fd >= channels_.size())
+        channels_.resize(std::max(fd + 1, channels_.size() * 2), nullptr);
+    if(channels_[fd] == nullptr)
+        numChannels_++;
+    channels_[fd] = channel;
+}
+
+void Poller::eraseChannel(int fd) {
+    size_t index = static_cast<size_t>(fd);
+    if(index < channels_.size() && channels_[index] != nullptr) {
+        channels_[index] = nullptr;
+        numChannels_--;
+    }
+}
+
+size_t Poller::numChannels() const {
+    return numChannels_;
+}
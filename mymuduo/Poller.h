@@ -3,18 +3,24 @@
 #include "Timestamp.h"
 #include "noncopyable.h"
 
-#include <unordered_map>
+#include <cstddef>
+#include <string>
+#include <sys/types.h>
 #include <vector>
 
 
+class Buffer;
 class Channel;
 class EventLoop;
+struct iovec;
 
 class Poller: noncopyable {
 public:
     typedef std::vector<Channel*> ChannelList;
+    using Factory = Poller* (*)(EventLoop *loop);
 protected:
-    typedef std::unordered_map<int, Channel*> ChannelMap;
+    // indexed by fd, fds are small dense integers so a flat table beats hashing them
+    typedef std::vector<Channel*> ChannelTable;
 
 public:
     Poller(EventLoop *loop);
@@ -25,12 +31,41 @@ public:
     virtual void removeChannel(Channel *channel) = 0;
 
     bool hasChannel(Channel *channel) const;
+    // whether Channel::setEdgeTriggered can take effect, level-triggered only backends say no
+    virtual bool edgeTriggeredSupported() const;
 
+    // completion-based IO, only UringPoller in completion mode has it. an attached channel owns a read and
+    // a write buffer registered with the kernel, its reads and writes are submitted into them, and the channel
+    // becomes active when one finishes: EPOLLIN for a read, EPOLLOUT for a write. readiness interest keeps
+    // working alongside. false when the backend has no completion IO or no buffers are left
+    virtual bool attachIoBuffers(Channel *channel);
+    // submit a read into the channel's buffer, false while the last one is in flight or not finished yet
+    virtual bool startRead(Channel *channel);
+    // bytes of the finished read appended to buf, 0 at end of file, -errno on error, -EAGAIN if none finished
+    virtual ssize_t finishRead(Channel *channel, Buffer *buf);
+    // copy up to one buffer of iov and submit writing it, returns the bytes taken, 0 while a write is in flight
+    virtual size_t startWrite(Channel *channel, const iovec *iov, int iovcnt);
+    // all bytes taken by the finished write or -errno, -EAGAIN if none finished
+    virtual ssize_t finishWrite(Channel *channel);
+
+    // MUDUO_POLLER=<name> picks a registered backend, MUDUO_USE_POLL and MUDUO_USE_URING are shorthands,
+    // MUDUO_USE_URING=completion also moves TcpConnection reads and writes onto the ring (experimental). epoll otherwise
     static Poller* newDefaultPoller(EventLoop *loop);
 
+    // named backends, "epoll", "poll", "uring" and "uring-completion" are built in. thread safe
+    static void registerPoller(const std::string &name, Factory factory);
+    // nullptr for an unknown name
+    static Poller* newPoller(const std::string &name, EventLoop *loop);
+    static std::vector<std::string> pollerNames();
+
 protected:
-    ChannelMap channels_;
+    void addChannel(Channel *channel);
+    void eraseChannel(int fd);
+    size_t numChannels() const;
+
 private:
+    ChannelTable channels_;
+    size_t numChannels_;
     EventLoop *ownerloop_;
 };
 
@@ -0,0 +1,157 @@
+#include "TcpClient.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <sys/socket.h>
+
+
+static void defaultConnectionCallback(const TcpConnectionPtr &conn) {
+    LOG_DEBUG("%s:%s:%d => TcpConnection=%s %s.", __FILENAME__, __FUNCTION__, __LINE__, conn->name().c_str(), conn->connected() ? "UP" : "DOWN");
+}
+
+static void defaultMessageCallback(const TcpConnectionPtr&, Buffer *buf, Timestamp) {
+    buf->retrieveAll();
+}
+
+static InetAddress sockAddress(int sockfd, bool peer) {
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    socklen_t addrlen = sizeof addr;
+    int ret = peer ? getpeername(sockfd, (sockaddr*)&addr, &addrlen) : getsockname(sockfd, (sockaddr*)&addr, &addrlen);
+    if(ret < 0)
+        LOG_ERROR("%s:%s:%d => socket fd=%d get %s address fail, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, sockfd, peer ? "peer" : "local", errno);
+    return InetAddress(addr);
+}
+
+TcpClient::TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg):
+    loop_(loop),
+    connector_(new Connector(loop, serverAddr)),
+    name_(nameArg),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    retry_(false),
+    connect_(false),
+    nextConnId_(1) {
+
+    connector_->setNewConnectionCallback(std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    LOG_DEBUG("%s:%s:%d => TcpClient=%s to %s create.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), serverAddr.toIpPort().c_str());
+}
+
+TcpClient::~TcpClient() {
+    TcpConnectionPtr conn;
+    bool unique = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        unique = connection_.use_count() == 1;
+        conn = connection_;
+    }
+
+    if(conn) {
+        // the connection may outlive this client, from now on its close must not call back into us
+        EventLoop *loop = loop_;
+        CloseCallback detached = [loop](const TcpConnectionPtr &c) {
+            loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+        };
+        loop_->runInLoop([conn, detached]() { conn->setCloseCallback(detached); });
+        if(unique)
+            conn->forceClose();
+    }
+    connector_->stop();
+    LOG_DEBUG("%s:%s:%d => TcpClient=%s destroy.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str());
+}
+
+void TcpClient::connect() {
+    LOG_DEBUG("%s:%s:%d => TcpClient=%s connecting to %s.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect() {
+    connect_ = false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(connection_)
+        connection_->shutdown();
+}
+
+void TcpClient::stop() {
+    connect_ = false;
+    connector_->stop();
+}
+
+TcpConnectionPtr TcpClient::connection() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_;
+}
+
+EventLoop* TcpClient::getLoop() const {
+    return loop_;
+}
+
+const std::string& TcpClient::name() const {
+    return name_;
+}
+
+bool TcpClient::retry() const {
+    return retry_;
+}
+
+void TcpClient::enableRetry() {
+    retry_ = true;
+}
+
+void TcpClient::setConnectionCallback(const ConnectionCallback &cb) {
+    connectionCallback_ = cb;
+}
+
+void TcpClient::setMessageCallback(const MessageCallback &cb) {
+    messageCallback_ = cb;
+}
+
+void TcpClient::setWriteCompleteCallback(const WriteCompleteCallback &cb) {
+    writeCompleteCallback_ = cb;
+}
+
+void TcpClient::setMaxConnectRetries(int n) {
+    connector_->setMaxRetries(n);
+}
+
+void TcpClient::setConnectFailedCallback(const std::function<void()> &cb) {
+    connector_->setConnectFailedCallback(cb);
+}
+
+void TcpClient::newConnection(int sockfd) {
+    InetAddress peerAddr(sockAddress(sockfd, true));
+    char buf[64] = {0};
+    snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_++);
+    std::string connName = name_ + buf;
+
+    TcpConnectionPtr conn(new TcpConnection(loop_, connName, sockfd, sockAddress(sockfd, false), peerAddr));
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setCloseCallback(std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+// called in the loop thread from the connection's handleClose
+void TcpClient::removeConnection(const TcpConnectionPtr &conn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_.reset();
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+
+    if(retry_ && connect_) {
+        LOG_INFO("%s:%s:%d => TcpClient=%s reconnecting to %s.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
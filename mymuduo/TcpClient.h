@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Callbacks.h"
+#include "Connector.h"
+#include "InetAddress.h"
+#include "noncopyable.h"
+#include "TcpConnection.h"
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+
+
+class EventLoop;
+
+// one outgoing connection: a Connector opens the socket, a TcpConnection in the same loop carries it.
+// connect/disconnect/stop are thread safe; destroy the client in its loop thread.
+// with retry enabled the client reconnects after an established connection goes down
+class TcpClient: noncopyable {
+public:
+    TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    ~TcpClient();
+
+    void connect();
+    // shut down the write side of the established connection
+    void disconnect();
+    // stop connecting, an established connection is left alone
+    void stop();
+
+    TcpConnectionPtr connection() const;
+    EventLoop* getLoop() const;
+    const std::string& name() const;
+
+    bool retry() const;
+    void enableRetry();
+
+    // set before connect()
+    void setConnectionCallback(const ConnectionCallback &cb);
+    void setMessageCallback(const MessageCallback &cb);
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb);
+    // see Connector::setMaxRetries and Connector::setConnectFailedCallback
+    void setMaxConnectRetries(int n);
+    void setConnectFailedCallback(const std::function<void()> &cb);
+
+private:
+    void newConnection(int sockfd);
+    void removeConnection(const TcpConnectionPtr &conn);
+
+private:
+    EventLoop *loop_;
+    ConnectorPtr connector_;
+    const std::string name_;
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    int nextConnId_;    // loop thread only
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_;   // guarded by mutex_
+};
@@ -10,8 +10,10 @@
 #include <cerrno>
 #include <functional>
 #include <string>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 
@@ -31,6 +33,8 @@ TcpConnection::TcpConnection(EventLoop *loop,
     name_(nameArg),
     state_(kConnecting),
     reading_(true),
+    completionIo_(false),
+    writeInFlight_(0),
     socket_(new Socket(sockfd)),
     channel_(new Channel(loop, sockfd)),
     localAddr_(localAddr),
@@ -43,6 +47,8 @@ TcpConnection::TcpConnection(EventLoop *loop,
     channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
 
     LOG_DEBUG("%s:%s:%d => TcpConnection=%s at socket fd=%d create.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), sockfd);
+    // counted as soon as the loop is picked, so a burst of accepts sees its own assignments
+    loop_->adjustConnectionCount(1);
     socket_->setKeepAlive(true);
 }
 
@@ -94,7 +100,14 @@ void TcpConnection::setCloseCallback(const CloseCallback& cb) {
 void TcpConnection::connectEstablished() {
     setState(kConnected);
     channel_->tie(shared_from_this());
-    channel_->enableReading();
+    // on a completion-mode io_uring loop a read is submitted up front instead of polling for input
+    completionIo_ = !channel_->edgeTriggered() && loop_->attachIoBuffers(channel_.get());
+    if(completionIo_)
+        loop_->startRead(channel_.get());
+    else
+        channel_->enableReading();
+    if(idleWheel_)
+        idleEntry_ = idleWheel_->add(shared_from_this());
 
     connectionCallback_(shared_from_this());
 }
@@ -106,6 +119,7 @@ void TcpConnection::connectDestroyed() {
         connectionCallback_(shared_from_this());
     }
     channel_->remove();
+    loop_->adjustConnectionCount(-1);
 }
 
 void TcpConnection::setState(StateE state) {
@@ -113,26 +127,71 @@ void TcpConnection::setState(StateE state) {
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime) {
+    if(completionIo_) {
+        handleReadCompletion(receiveTime);
+        return ;
+    }
+
+    const bool edgeTriggered = channel_->edgeTriggered();
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if(n > 0)
+    ssize_t total = 0;
+    ssize_t n = 0;
+    bool capped = false;
+    // edge-triggered gets no second event for bytes left in the socket, so read until a short read,
+    // anything arriving after that raises a new edge. past kMaxEdgeReadBytes the rest is read by a
+    // queued continueRead instead, after the other channels of this round had their turn
+    while(true) {
+        size_t space = inputBuffer_.writableBytes();
+        if(space < Buffer::kExtraBufSize)
+            space += Buffer::kExtraBufSize;
+        n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+        if(n <= 0)
+            break;
+        total += n;
+        if(!edgeTriggered || static_cast<size_t>(n) < space)
+            break;
+        if(static_cast<size_t>(total) >= kMaxEdgeReadBytes) {
+            capped = true;
+            break;
+        }
+    }
+    if(capped)
+        loop_->queueInLoop(std::bind(&TcpConnection::continueRead, shared_from_this()));
+
+    if(total > 0) {
+        if(idleEntry_)
+            idleWheel_->touch(idleEntry_);
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
-    else if(n == 0)
-        handleClose();
-    else {
+    }
+
+    if(n == 0) {
+        // the message callback may already have closed it
+        if(state_ != kDisconnected)
+            handleClose();
+    }
+    else if(n < 0 && !(edgeTriggered && savedErrno == EWOULDBLOCK)) {
         errno = savedErrno;
         LOG_ERROR("%s:%s:%d => data read to TcpConnection=%s at socket fd=%d's buffer fail.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), channel_->fd());
         handleError();
     }
 }
 
+void TcpConnection::continueRead() {
+    // the message callback may have closed the connection meanwhile
+    if(state_ == kConnected || state_ == kDisconnecting)
+        handleRead(loop_->cachedNow());
+}
+
 void TcpConnection::handleWrite() {
+    if(writeInFlight_ > 0) {
+        handleWriteCompletion();
+        return ;
+    }
+
     if(channel_->isWriting()) {
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
-        if(n > 0) {
-            outputBuffer_.retrieve(n);
-            if(outputBuffer_.readableBytes() == 0) {
+        if(flushOutput(&savedErrno)) {
+            if(outputBuffer_.readableBytes() == 0 && pendingFiles_.empty()) {
                 channel_->disableWriting();
                 if(writeCompleteCallback_)
                     loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
@@ -147,6 +206,66 @@ void TcpConnection::handleWrite() {
         LOG_ERROR("%s:%s:%d => TcpConnection=%s at socket fd=%d is down, no more writing.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), channel_->fd());
 }
 
+void TcpConnection::handleReadCompletion(Timestamp receiveTime) {
+    ssize_t n = loop_->finishRead(channel_.get(), &inputBuffer_);
+    // closed meanwhile, a disabled channel gets no more input in readiness mode either
+    if(n == -EAGAIN || state_ == kDisconnected)
+        return ;
+
+    if(n > 0) {
+        // the read buffer is free again, the kernel fills it while the message callback runs
+        loop_->startRead(channel_.get());
+        if(idleEntry_)
+            idleWheel_->touch(idleEntry_);
+        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    }
+    else if(n == 0)
+        handleClose();
+    else {
+        // no poll is watching the socket, so the connection is closed here rather than on EPOLLHUP
+        errno = static_cast<int>(-n);
+        LOG_ERROR("%s:%s:%d => data read to TcpConnection=%s at socket fd=%d's buffer fail.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), channel_->fd());
+        handleError();
+        handleClose();
+    }
+}
+
+void TcpConnection::handleWriteCompletion() {
+    ssize_t n = loop_->finishWrite(channel_.get());
+    if(n == -EAGAIN)
+        return ;
+
+    writeInFlight_ = 0;
+    if(n < 0) {
+        // the read in flight fails too and closes the connection
+        errno = static_cast<int>(-n);
+        LOG_ERROR("%s:%s:%d => data write from TcpConnection=%s at socket fd=%d's buffer fail.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), channel_->fd());
+        return ;
+    }
+    if(state_ == kDisconnected)
+        return ;
+
+    if(!pendingFiles_.empty())
+        // sendfile has no completion counterpart here, the rest goes out on readiness through handleWrite
+        channel_->enableWriting();
+    else if(outputBuffer_.readableBytes() > 0)
+        startOutputWrite();
+    else {
+        if(writeCompleteCallback_)
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        if(state_ == kDisconnecting)
+            shutdownInLoop();
+    }
+}
+
+// hand the front of outputBuffer_ to the loop's write buffer, at most one in flight
+void TcpConnection::startOutputWrite() {
+    struct iovec vec[8];
+    int iovcnt = outputBuffer_.frontIovecs(vec, 8, outputBuffer_.readableBytes());
+    writeInFlight_ = loop_->startWrite(channel_.get(), vec, iovcnt);
+    outputBuffer_.retrieve(writeInFlight_);
+}
+
 void TcpConnection::handleClose() {
     LOG_DEBUG("%s:%s:%d => TcpConnection=%s at socket fd=%d will close, state=%d", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), channel_->fd(), (int)state_);
     setState(kDisconnected);
@@ -179,7 +298,18 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
         return ;
     }
     
-    if(!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
+    if(completionIo_ && !channel_->isWriting()) {
+        // copied into the loop's write buffer right away, whatever does not fit waits in outputBuffer_
+        if(writeInFlight_ == 0 && outputBuffer_.readableBytes() == 0) {
+            struct iovec vec;
+            vec.iov_base = const_cast<void*>(data);
+            vec.iov_len = len;
+            writeInFlight_ = loop_->startWrite(channel_.get(), &vec, 1);
+            nwrote = static_cast<ssize_t>(writeInFlight_);
+            remaining = len - writeInFlight_;
+        }
+    }
+    else if(!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
         nwrote = write(channel_->fd(), data, len);
         if(nwrote >= 0) {
             remaining = len - nwrote;
@@ -201,22 +331,130 @@ void TcpConnection::sendInLoop(const void *data, size_t len) {
         if(oldLen + remaining >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
             loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
         outputBuffer_.append((char*)data + nwrote, remaining);
-        if(!channel_->isWriting())
+        // a completion write in flight picks the rest up when it finishes
+        if(!channel_->isWriting() && writeInFlight_ == 0)
             channel_->enableWriting();
     }
 }
 
+void TcpConnection::sendStringInLoop(const std::string &buf) {
+    sendInLoop(buf.data(), buf.size());
+}
+
+void TcpConnection::sendBufferInLoop(const Buffer &buf) {
+    sendInLoop(buf.peek(), buf.readableBytes());
+}
+
+void TcpConnection::sendSliceInLoop(const std::shared_ptr<const std::string> &data, size_t offset, size_t len) {
+    sendInLoop(data->data() + offset, len);
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t len) {
+    if(state_ == kDisconnected) {
+        LOG_ERROR("%s:%s:%d => TcpConnection=%s at socket fd=%d is disconnected, giveup sending file fd=%d.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), channel_->fd(), fd);
+        return ;
+    }
+
+    size_t bufferedBefore = outputBuffer_.readableBytes();
+    for(const FileSegment &file: pendingFiles_) {
+        bufferedBefore -= file.bufferedBefore;
+    }
+    pendingFiles_.push_back(FileSegment{fd, offset, len, bufferedBefore});
+
+    // nothing in flight, so outputBuffer_ is empty and the file can go out right away.
+    // behind a completion write the file waits for it to finish
+    if(!channel_->isWriting() && writeInFlight_ == 0) {
+        int savedErrno = 0;
+        if(!flushOutput(&savedErrno)) {
+            LOG_ERROR("%s:%s:%d => TcpConnection=%s at socket fd=%d sendfile from fd=%d fail, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), channel_->fd(), fd, savedErrno);
+            return ;
+        }
+        if(pendingFiles_.empty()) {
+            if(writeCompleteCallback_)
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        else
+            channel_->enableWriting();
+    }
+}
+
+// returns false on a socket or file error, a full socket buffer is not an error.
+// edge-triggered sockets report EPOLLOUT again only once the send buffer has filled up,
+// so there one pass is not enough and writing goes on until EAGAIN or nothing is left.
+bool TcpConnection::flushOutput(int *savedErrno) {
+    bool ok = writeOutput(savedErrno);
+    while(ok && channel_->edgeTriggered() && *savedErrno != EWOULDBLOCK
+            && (outputBuffer_.readableBytes() > 0 || !pendingFiles_.empty()))
+        ok = writeOutput(savedErrno);
+    return ok;
+}
+
+// write queued bytes and files in the order they were sent, stopping at the first short write.
+bool TcpConnection::writeOutput(int *savedErrno) {
+    while(!pendingFiles_.empty()) {
+        FileSegment &file = pendingFiles_.front();
+        if(file.bufferedBefore > 0) {
+            ssize_t n = outputBuffer_.writeFd(channel_->fd(), savedErrno, file.bufferedBefore);
+            if(n < 0)
+                return *savedErrno == EWOULDBLOCK;
+            outputBuffer_.retrieve(n);
+            file.bufferedBefore -= n;
+            if(file.bufferedBefore > 0)
+                return true;
+        }
+
+        ssize_t n = file.remaining > 0 ? sendfile(channel_->fd(), file.fd, &file.offset, file.remaining) : 0;
+        if(n < 0) {
+            *savedErrno = errno;
+            if(errno == EWOULDBLOCK)
+                return true;
+            pendingFiles_.pop_front();
+            return false;
+        }
+        if(n == 0 && file.remaining > 0) {
+            LOG_ERROR("%s:%s:%d => TcpConnection=%s at socket fd=%d file fd=%d ends %lu bytes early.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), channel_->fd(), file.fd, file.remaining);
+            file.remaining = 0;
+        }
+        file.remaining -= n;
+        if(file.remaining > 0)
+            return true;
+        pendingFiles_.pop_front();
+    }
+
+    if(outputBuffer_.readableBytes() > 0) {
+        ssize_t n = outputBuffer_.writeFd(channel_->fd(), savedErrno);
+        if(n < 0)
+            return *savedErrno == EWOULDBLOCK;
+        outputBuffer_.retrieve(n);
+    }
+    return true;
+}
+
 void TcpConnection::shutdownInLoop() {
-    if(!channel_->isWriting())
+    if(!channel_->isWriting() && writeInFlight_ == 0)
         socket_->shutdownWrite();
 }
 
+void TcpConnection::forceCloseInLoop() {
+    if(state_ == kConnected || state_ == kDisconnecting)
+        handleClose();
+}
+
 void TcpConnection::send(const std::string &buf) {
     if(state_ == kConnected) {
         if(loop_->isInLoopThread())
-            sendInLoop(buf.c_str(), buf.size());
+            sendInLoop(buf.data(), buf.size());
         else
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), buf));
+    }
+}
+
+void TcpConnection::send(std::string &&buf) {
+    if(state_ == kConnected) {
+        if(loop_->isInLoopThread())
+            sendInLoop(buf.data(), buf.size());
+        else
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(buf)));
     }
 }
 
@@ -225,7 +463,42 @@ void TcpConnection::send(Buffer &buf) {
         if(loop_->isInLoopThread())
             sendInLoop(buf.peek(), buf.readableBytes());
         else
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.peek(), buf.readableBytes()));
+            loop_->runInLoop(std::bind(&TcpConnection::sendBufferInLoop, shared_from_this(), buf));
+    }
+}
+
+void TcpConnection::send(Buffer &&buf) {
+    if(state_ == kConnected) {
+        if(loop_->isInLoopThread())
+            sendInLoop(buf.peek(), buf.readableBytes());
+        else
+            loop_->runInLoop(std::bind(&TcpConnection::sendBufferInLoop, shared_from_this(), std::move(buf)));
+    }
+}
+
+void TcpConnection::send(const std::shared_ptr<const std::string> &data) {
+    send(data, 0, data->size());
+}
+
+void TcpConnection::send(const std::shared_ptr<const std::string> &data, size_t offset, size_t len) {
+    if(offset > data->size() || len > data->size() - offset) {
+        LOG_ERROR("%s:%s:%d => TcpConnection=%s slice offset=%zu len=%zu is out of a %zu byte string, giveup sending.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), offset, len, data->size());
+        return ;
+    }
+    if(state_ == kConnected) {
+        if(loop_->isInLoopThread())
+            sendInLoop(data->data() + offset, len);
+        else
+            loop_->runInLoop(std::bind(&TcpConnection::sendSliceInLoop, shared_from_this(), data, offset, len));
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t len) {
+    if(state_ == kConnected) {
+        if(loop_->isInLoopThread())
+            sendFileInLoop(fd, offset, len);
+        else
+            loop_->runInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), fd, offset, len));
     }
 }
 
@@ -236,5 +509,24 @@ void TcpConnection::shutdown() {
     }
 }
 
+void TcpConnection::forceClose() {
+    if(state_ == kConnected || state_ == kDisconnecting) {
+        setState(kDisconnecting);
+        loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::setIdleWheel(const std::shared_ptr<TimingWheel> &wheel) {
+    idleWheel_ = wheel;
+}
+
+void TcpConnection::setEdgeTriggered(bool on) {
+    channel_->setEdgeTriggered(on);
+}
+
+bool TcpConnection::completionIo() const {
+    return completionIo_;
+}
+
 
 
@@ -2,13 +2,17 @@
 
 #include "Buffer.h"
 #include "Callbacks.h"
+#include "ChainBuffer.h"
 #include "InetAddress.h"
 #include "noncopyable.h"
 #include "Timestamp.h"
+#include "TimingWheel.h"
 
 #include <atomic>
+#include <deque>
 #include <memory>
 #include <string>
+#include <sys/types.h>
 
 
 class Channel;
@@ -40,28 +44,75 @@ public:
     void connectEstablished();
     void connectDestroyed();
 
+    // thread safe. off the loop thread the bytes are copied into the queued task,
+    // the rvalue overloads move the payload in instead and the shared one only bumps a reference count.
     void send(const std::string &buf);
+    void send(std::string &&buf);
     void send(Buffer &buf);
+    void send(Buffer &&buf);
+    void send(const std::shared_ptr<const std::string> &data);
+    void send(const std::shared_ptr<const std::string> &data, size_t offset, size_t len);
+    // stream len bytes of fd from offset with sendfile(2), after everything already sent.
+    // the caller keeps fd open until the write complete callback fires or the connection goes down.
+    void sendFile(int fd, off_t offset, size_t len);
 
     void shutdown();
+    void forceClose();
+
+    // register the socket edge-triggered, call before connectEstablished()
+    void setEdgeTriggered(bool on);
+    // whether reads and writes are submitted to a completion-mode io_uring loop rather than done on readiness,
+    // decided in connectEstablished(). edge-triggered connections, and any past the loop's io buffers, say no
+    bool completionIo() const;
+
+    // age this connection on the wheel, closing it after the wheel's timeout without input
+    void setIdleWheel(const std::shared_ptr<TimingWheel> &wheel);
 
 private:
     enum StateE {kDisconnected, kDisconnecting, kConnected, kConnecting};
     void setState(StateE state);
 
     void handleRead(Timestamp receiveTime);
+    void continueRead();
     void handleWrite();
+    // completion IO counterparts, see completionIo()
+    void handleReadCompletion(Timestamp receiveTime);
+    void handleWriteCompletion();
+    void startOutputWrite();
     void handleClose();
     void handleError();
 
     void sendInLoop(const void *data, size_t len);
+    void sendStringInLoop(const std::string &buf);
+    void sendBufferInLoop(const Buffer &buf);
+    void sendSliceInLoop(const std::shared_ptr<const std::string> &data, size_t offset, size_t len);
+    void sendFileInLoop(int fd, off_t offset, size_t len);
+    bool flushOutput(int *savedErrno);
+    bool writeOutput(int *savedErrno);
     void shutdownInLoop();
+    void forceCloseInLoop();
+
+public:
+    // edge-triggered reads stop after this many bytes per event and resume from a queued task,
+    // so a fast sender can neither grow the input buffer unboundedly nor starve the loop's other channels
+    static const size_t kMaxEdgeReadBytes = 4 * Buffer::kExtraBufSize;
 
 private:
+    struct FileSegment {
+        int fd;
+        off_t offset;
+        size_t remaining;
+        // bytes of outputBuffer_ sent before this file and after the previous one
+        size_t bufferedBefore;
+    };
+
     EventLoop *loop_;
     const std::string name_;
     std::atomic_int state_;
     bool reading_;
+    bool completionIo_;
+    // bytes handed to the loop's write in flight, they have left outputBuffer_ already
+    size_t writeInFlight_;
 
     std::unique_ptr<Socket> socket_;
     std::unique_ptr<Channel> channel_;
@@ -77,7 +128,11 @@ private:
     size_t highWaterMark_;
 
     Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    ChainBuffer outputBuffer_;
+    std::deque<FileSegment> pendingFiles_;
+
+    std::shared_ptr<TimingWheel> idleWheel_;
+    TimingWheel::EntryPtr idleEntry_;
 };
 
 
@@ -10,6 +10,8 @@
 #include <cstdio>
 #include <cstring>
 #include <functional>
+#include <future>
+#include <mutex>
 #include <string>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -21,25 +23,61 @@ static EventLoop* CheckLoopNotNull(EventLoop *loop) {
     return loop;
 }
 
+static void closeIdleConnection(const std::shared_ptr<void> &owner) {
+    std::static_pointer_cast<TcpConnection>(owner)->forceClose();
+}
+
 TcpServer::TcpServer(EventLoop *loop, const InetAddress &listenAddr,
                         const std::string &nameArg, Option option):
     loop_(CheckLoopNotNull(loop)),
+    listenAddr_(listenAddr),
     ipPort_(listenAddr.toIpPort()),
     name_(nameArg),
-    acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+    option_(option),
     threadPool_(new EventLoopThreadPool(loop, name_)),
     connectionCallback_(),
     messageCallback_(),
+    started_(0),
+    maxAcceptsPerWakeup_(Acceptor::kDefaultMaxAcceptsPerWakeup),
+    edgeTriggered_(false),
     nextConnId_(1),
-    started_(0) {
+    idleTimeoutSeconds_(0) {
 
-    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
-        std::placeholders::_1, std::placeholders::_2));
+    if(option_ != kReusePortPerLoop) {
+        acceptor_.reset(new Acceptor(loop, listenAddr, option == kReusePort));
+        acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this,
+            std::placeholders::_1, std::placeholders::_2));
+    }
 }
 
 
 TcpServer::~TcpServer() {
-    for(auto &item: connections_) {
+    // a loop acceptor's channel belongs to its loop, remove it there and wait so no accept races the teardown
+    for(std::unique_ptr<Acceptor> &acceptor: loopAcceptors_) {
+        EventLoop *ioLoop = acceptor->ownerLoop();
+        if(ioLoop->isInLoopThread()) {
+            acceptor.reset();
+        }
+        else {
+            std::promise<void> done;
+            ioLoop->runInLoop([&acceptor, &done]() {
+                acceptor.reset();
+                done.set_value();
+            });
+            done.get_future().wait();
+        }
+    }
+
+    for(auto &item: idleWheels_) {
+        item.second->stop();
+    }
+
+    ConnectionMap connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections.swap(connections_);
+    }
+    for(auto &item: connections) {
         TcpConnectionPtr conn(item.second);
         item.second.reset();
 
@@ -67,19 +105,84 @@ void TcpServer::setThreadNum(int numThreads) {
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setThreadPlacement(const CpuPlacement &placement) {
+    threadPool_->setPlacement(placement);
+}
+
+void TcpServer::setLoopDistribution(EventLoopThreadPool::Distribution distribution) {
+    threadPool_->setDistribution(distribution);
+}
+
+void TcpServer::setIdleTimeout(int seconds) {
+    idleTimeoutSeconds_ = seconds;
+}
+
+void TcpServer::setEdgeTriggered(bool on) {
+    edgeTriggered_ = on;
+}
+
+void TcpServer::setMaxAcceptsPerWakeup(int n) {
+    maxAcceptsPerWakeup_ = n;
+    if(acceptor_)
+        acceptor_->setMaxAcceptsPerWakeup(n);
+}
+
 void TcpServer::start() {
     if(started_++ == 0) {
         threadPool_->start(threadInitCallback_);
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        if(idleTimeoutSeconds_ > 0) {
+            for(EventLoop *ioLoop: threadPool_->getAllLoops()) {
+                std::shared_ptr<TimingWheel> wheel(new TimingWheel(ioLoop, idleTimeoutSeconds_));
+                wheel->setExpireCallback(closeIdleConnection);
+                wheel->start();
+                idleWheels_[ioLoop] = wheel;
+            }
+        }
+        if(option_ == kReusePortPerLoop) {
+            for(EventLoop *ioLoop: threadPool_->getAllLoops()) {
+                Acceptor *acceptor = new Acceptor(ioLoop, listenAddr_, true);
+                acceptor->setMaxAcceptsPerWakeup(maxAcceptsPerWakeup_);
+                acceptor->setNewConnectionCallback(std::bind(&TcpServer::establishConnection, this,
+                    ioLoop, std::placeholders::_1, std::placeholders::_2));
+                loopAcceptors_.emplace_back(acceptor);
+                // wait, so the server accepts as soon as start() returns just like with the base loop acceptor
+                if(ioLoop->isInLoopThread()) {
+                    acceptor->listen();
+                }
+                else {
+                    std::promise<void> done;
+                    ioLoop->runInLoop([acceptor, &done]() {
+                        acceptor->listen();
+                        done.set_value();
+                    });
+                    done.get_future().wait();
+                }
+            }
+        }
+        else {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        }
     }
     
 }
 
+AcceptStats TcpServer::acceptStats() const {
+    AcceptStats stats;
+    if(acceptor_)
+        stats += acceptor_->stats();
+    for(const std::unique_ptr<Acceptor> &acceptor: loopAcceptors_) {
+        stats += acceptor->stats();
+    }
+    return stats;
+}
+
 void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
-    EventLoop *ioLoop = threadPool_->getNextLoop();
+    establishConnection(threadPool_->getNextLoop(peerAddr), sockfd, peerAddr);
+}
+
+void TcpServer::establishConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr) {
     char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
+    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_++);
     std::string connName = name_ + buf;
 
     LOG_DEBUG("%s:%s:%d => new TcpConnection=%s at socket fd=%d from %s will create.", __FILENAME__, __FUNCTION__, __LINE__, connName.c_str(), sockfd, peerAddr.toIpPort().c_str());
@@ -92,26 +195,39 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr) {
     InetAddress localAddr(local);
 
     TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-    connections_[connName] = conn;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_[connName] = conn;
+    }
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setEdgeTriggered(edgeTriggered_);
+    // per-loop acceptors get here from several io threads at once. idleWheels_ is complete before they exist,
+    // so a lookup is only a read, operator[] is not
+    IdleWheelMap::const_iterator wheel = idleWheels_.find(ioLoop);
+    if(wheel != idleWheels_.end())
+        conn->setIdleWheel(wheel->second);
 
     conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+    // runs inline when the accepting loop is the connection's own loop
     ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
     
 }
 
+// called in the connection's io loop. the map is shared, so erase under the lock right here
+// instead of bouncing through the base loop
 void TcpServer::removeConnection(const TcpConnectionPtr &conn) {
-    loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
-}
-
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn) {
     LOG_DEBUG("%s:%s:%d => new TcpConnection=%s will remove", __FILENAME__, __FUNCTION__, __LINE__, conn->name().c_str());
 
-    connections_.erase(conn->name());
-    EventLoop *ioLoop = conn->getLoop();
-    ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    size_t n = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        n = connections_.erase(conn->name());
+    }
+    // zero means ~TcpServer already took it and scheduled connectDestroyed
+    if(n == 1)
+        conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
 }
 
 
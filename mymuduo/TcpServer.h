@@ -9,12 +9,15 @@
 #include "noncopyable.h"
 #include "TcpConnection.h"
 #include "Timestamp.h"
+#include "TimingWheel.h"
 
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 
 class TcpServer: noncopyable {
@@ -22,11 +25,15 @@ public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
 private:
     using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    using IdleWheelMap = std::unordered_map<EventLoop*, std::shared_ptr<TimingWheel>>;
 
 public:
     enum Option{
         kNoReusePort,
-        kReusePort
+        kReusePort,
+        // every io loop owns its own SO_REUSEPORT listener, the kernel spreads accepts across them
+        // and each connection lives in the loop that accepted it, no cross-thread handoff
+        kReusePortPerLoop
     };
 
     TcpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg, Option option = kNoReusePort);
@@ -38,19 +45,40 @@ public:
     void setWriteCompleteCallback(const WriteCompleteCallback &cb);
 
     void setThreadNum(int numThreads);
+    // pin io loop threads, see CpuPlacement. call before start()
+    void setThreadPlacement(const CpuPlacement &placement);
+    // how new connections are spread over the io loops, round robin by default.
+    // kReusePortPerLoop keeps every connection in the loop that accepted it and ignores this
+    void setLoopDistribution(EventLoopThreadPool::Distribution distribution);
+    // close connections that receive nothing for this long, 0 disables. call before start()
+    void setIdleTimeout(int seconds);
+
+    // register connection sockets edge-triggered, see Channel::setEdgeTriggered. call before start()
+    void setEdgeTriggered(bool on);
+    // see Acceptor::setMaxAcceptsPerWakeup, call before start()
+    void setMaxAcceptsPerWakeup(int n);
 
     void start();
 
+    // summed over every acceptor of this server
+    AcceptStats acceptStats() const;
+
 private:
     void newConnection(int sockfd, const InetAddress &peerAddr);
+    // runs in whichever loop accepted, ioLoop is where the connection will live
+    void establishConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
     void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
 
 private:
     EventLoop *loop_;
+    const InetAddress listenAddr_;
     const std::string ipPort_;
     const std::string name_;
+    const Option option_;
+    // the base loop acceptor, null in kReusePortPerLoop mode
     std::unique_ptr<Acceptor> acceptor_;
+    // kReusePortPerLoop only, one per io loop and destroyed in that loop
+    std::vector<std::unique_ptr<Acceptor>> loopAcceptors_;
     std::shared_ptr<EventLoopThreadPool> threadPool_;
 
     ConnectionCallback connectionCallback_;
@@ -59,9 +87,17 @@ private:
 
     ThreadInitCallback threadInitCallback_;
     std::atomic_int started_;
+    int maxAcceptsPerWakeup_;
+    bool edgeTriggered_;
 
-    int nextConnId_;
+    // connections are added and removed from every io loop in kReusePortPerLoop mode
+    std::atomic_int nextConnId_;
+    std::mutex mutex_;
     ConnectionMap connections_;
+
+    int idleTimeoutSeconds_;
+    // one wheel per io loop, filled in start() and read-only afterwards
+    IdleWheelMap idleWheels_;
 };
 
 
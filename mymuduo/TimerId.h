@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+
+class Timer;
+
+// opaque handle returned by EventLoop::runAt/runAfter/runEvery, used to cancel the timer
+class TimerId {
+public:
+    TimerId();
+    TimerId(Timer *timer, int64_t seq);
+
+    friend class TimerQueue;
+
+private:
+    Timer *timer_;
+    int64_t sequence_;
+};
+
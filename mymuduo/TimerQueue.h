@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Callbacks.h"
+#include "Channel.h"
+#include "noncopyable.h"
+#include "Timestamp.h"
+
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+// timers of one EventLoop, all fired through a single timerfd registered in the loop's poller.
+// timers are kept ordered by expiration in a balanced tree, so insert, cancel and expire are O(log n).
+class TimerQueue: noncopyable {
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // thread safe, when is a Timestamp::monotonicNow() deadline
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+
+    void handleRead();
+
+    std::vector<Entry> getExpired(Timestamp now);
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+    bool insert(Timer *timer);
+
+private:
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+
+    // ordered by expiration, drives the timerfd
+    TimerList timers_;
+
+    // same timers ordered by address, used to find a timer on cancel
+    ActiveTimerSet activeTimers_;
+    bool callingExpiredTimers_;
+    ActiveTimerSet cancelingTimers_;
+};
+
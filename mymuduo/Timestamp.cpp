@@ -1,32 +1,92 @@
 #include "Timestamp.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <time.h>
-#include <cstdio>
 
 
-Timestamp::Timestamp(): msSince1900_(0) {}
+Timestamp::Timestamp(): microSecondsSinceEpoch_(0) {}
+
+Timestamp::Timestamp(int64_t microSecondsSinceEpoch): microSecondsSinceEpoch_(microSecondsSinceEpoch) {}
 
-Timestamp::Timestamp(int64_t msSince1900): msSince1900_(msSince1900) {}
+static Timestamp fromClock(clockid_t clock) {
+    timespec ts;
+    clock_gettime(clock, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+}
 
 Timestamp Timestamp::now() {
-    return Timestamp(time(nullptr));
+    return fromClock(CLOCK_REALTIME);
+}
+
+Timestamp Timestamp::monotonicNow() {
+    return fromClock(CLOCK_MONOTONIC);
+}
+
+Timestamp Timestamp::invalid() {
+    return Timestamp();
 }
 
 std::string Timestamp::toString() const {
-    char buf[128];
-    tm *tm_time = localtime(&msSince1900_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-            tm_time->tm_year + 1900,
-            tm_time->tm_mon + 1,
-            tm_time->tm_mday,
-            tm_time->tm_hour,
-            tm_time->tm_min,
-            tm_time->tm_sec);
+    char buf[32];
+    size_t n = formatTo(buf, sizeof buf);
+    return std::string(buf, n);
+}
+
+size_t Timestamp::formatTo(char *buf, size_t size) const {
+    thread_local time_t t_lastSecond = -1;
+    thread_local char t_formatted[32];
+    thread_local size_t t_length = 0;
+
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    if(seconds != t_lastSecond) {
+        tm tm_time;
+        localtime_r(&seconds, &tm_time);
+        int n = snprintf(t_formatted, sizeof t_formatted, "%4d/%02d/%02d %02d:%02d:%02d",
+                tm_time.tm_year + 1900,
+                tm_time.tm_mon + 1,
+                tm_time.tm_mday,
+                tm_time.tm_hour,
+                tm_time.tm_min,
+                tm_time.tm_sec);
+        t_length = std::min(static_cast<size_t>(n), sizeof t_formatted - 1);
+        t_lastSecond = seconds;
+    }
 
-    return buf;
+    if(size == 0)
+        return 0;
+    size_t n = std::min(t_length, size - 1);
+    memcpy(buf, t_formatted, n);
+    buf[n] = '\0';
+    return n;
 }
 
+int64_t Timestamp::microSecondsSinceEpoch() const {
+    return microSecondsSinceEpoch_;
+}
+
+bool Timestamp::valid() const {
+    return microSecondsSinceEpoch_ > 0;
+}
+
+bool operator<(Timestamp lhs, Timestamp rhs) {
+    return lhs.microSecondsSinceEpoch() < rhs.microSecondsSinceEpoch();
+}
 
+bool operator==(Timestamp lhs, Timestamp rhs) {
+    return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
+}
+
+double timeDifference(Timestamp high, Timestamp low) {
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+Timestamp addTime(Timestamp timestamp, double seconds) {
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
 
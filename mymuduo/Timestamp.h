@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -7,12 +8,35 @@
 class Timestamp {
 public:
     Timestamp();
-    explicit Timestamp(int64_t msSince1900);
+    explicit Timestamp(int64_t microSecondsSinceEpoch);
 
+    // wall clock, microseconds since the unix epoch
     static Timestamp now();
+    // CLOCK_MONOTONIC, microseconds since an arbitrary start. only comparable with other monotonic
+    // timestamps and immune to wall clock steps, meant for intervals and deadlines
+    static Timestamp monotonicNow();
+    static Timestamp invalid();
+
+    // "YYYY/MM/DD HH:MM:SS" in local time, for wall clock timestamps
     std::string toString() const;
+    // same into buf without allocating, returns the length written. the calendar fields are cached
+    // per thread and only recomputed with localtime_r when the second changes
+    size_t formatTo(char *buf, size_t size) const;
+
+    int64_t microSecondsSinceEpoch() const;
+    bool valid() const;
+
+public:
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
 
 private:
-    int64_t msSince1900_;
+    int64_t microSecondsSinceEpoch_;
 };
 
+bool operator<(Timestamp lhs, Timestamp rhs);
+bool operator==(Timestamp lhs, Timestamp rhs);
+
+// seconds from low to high
+double timeDifference(Timestamp high, Timestamp low);
+Timestamp addTime(Timestamp timestamp, double seconds);
+
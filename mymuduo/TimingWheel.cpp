@@ -0,0 +1,71 @@
+#include "TimingWheel.h"
+#include "EventLoop.h"
+
+
+struct TimingWheel::Entry {
+    std::weak_ptr<void> owner;
+    uint64_t tick;
+};
+
+// one extra slot so an entry stays idle for at least timeoutSeconds full ticks before expiring
+TimingWheel::TimingWheel(EventLoop *loop, int timeoutSeconds):
+    loop_(loop),
+    timeoutSeconds_(timeoutSeconds),
+    currentTick_(0),
+    buckets_(timeoutSeconds + 1) {}
+
+TimingWheel::~TimingWheel() {}
+
+void TimingWheel::setExpireCallback(ExpireCallback cb) {
+    expireCallback_ = std::move(cb);
+}
+
+void TimingWheel::start() {
+    std::weak_ptr<TimingWheel> weakWheel(shared_from_this());
+    timerId_ = loop_->runEvery(1.0, std::bind(&TimingWheel::onTick, weakWheel));
+}
+
+void TimingWheel::stop() {
+    loop_->cancel(timerId_);
+}
+
+TimingWheel::EntryPtr TimingWheel::add(const std::shared_ptr<void> &owner) {
+    EntryPtr entry(new Entry{owner, currentTick_});
+    buckets_[currentTick_ % buckets_.size()].push_back(entry);
+    return entry;
+}
+
+void TimingWheel::touch(const EntryPtr &entry) {
+    // already in the newest bucket, nothing to do for the rest of this tick
+    if(entry->tick == currentTick_)
+        return;
+    entry->tick = currentTick_;
+    buckets_[currentTick_ % buckets_.size()].push_back(entry);
+}
+
+void TimingWheel::tick() {
+    ++currentTick_;
+    const uint64_t slots = buckets_.size();
+    expiring_.swap(buckets_[currentTick_ % slots]);
+
+    // an entry touched since it was put in this bucket also sits in a newer one, just drop this reference
+    for(const EntryPtr &entry: expiring_) {
+        if(entry->tick + slots != currentTick_)
+            continue;
+        std::shared_ptr<void> owner = entry->owner.lock();
+        if(owner && expireCallback_)
+            expireCallback_(owner);
+    }
+    expiring_.clear();
+}
+
+int TimingWheel::timeoutSeconds() const {
+    return timeoutSeconds_;
+}
+
+void TimingWheel::onTick(const std::weak_ptr<TimingWheel> &weakWheel) {
+    std::shared_ptr<TimingWheel> wheel = weakWheel.lock();
+    if(wheel)
+        wheel->tick();
+}
+
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TimerId.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+class EventLoop;
+
+// hashed timing wheel with one-second slots for idle timeouts.
+// touching an entry and aging the wheel by one tick are both O(1) per entry,
+// unlike cancel + reinsert on a TimerQueue. every method except stop() must run in the loop thread.
+class TimingWheel: noncopyable, public std::enable_shared_from_this<TimingWheel> {
+public:
+    struct Entry;
+    using EntryPtr = std::shared_ptr<Entry>;
+    using ExpireCallback = std::function<void(const std::shared_ptr<void>&)>;
+
+    TimingWheel(EventLoop *loop, int timeoutSeconds);
+    ~TimingWheel();
+
+    void setExpireCallback(ExpireCallback cb);
+
+    // tick once per second on the owner loop
+    void start();
+    // thread safe
+    void stop();
+
+    EntryPtr add(const std::shared_ptr<void> &owner);
+    void touch(const EntryPtr &entry);
+    void tick();
+
+    int timeoutSeconds() const;
+
+private:
+    static void onTick(const std::weak_ptr<TimingWheel> &weakWheel);
+
+private:
+    using Bucket = std::vector<EntryPtr>;
+
+    EventLoop *loop_;
+    const int timeoutSeconds_;
+    uint64_t currentTick_;
+    std::vector<Bucket> buckets_;
+    Bucket expiring_;
+    ExpireCallback expireCallback_;
+    TimerId timerId_;
+};
+
@@ -0,0 +1,297 @@
+#include "UpstreamPool.h"
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpConnection.h"
+
+#include <algorithm>
+#include <cstdio>
+
+
+// how often idle connections are checked against the idle timeout
+static const double kSweepIntervalSeconds = 1.0;
+
+UpstreamPool::UpstreamPool(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg):
+    loop_(loop),
+    serverAddr_(serverAddr),
+    name_(nameArg),
+    maxIdle_(kDefaultMaxIdle),
+    minIdle_(0),
+    idleTimeout_(kDefaultIdleTimeout),
+    acquireTimeout_(kDefaultAcquireTimeout),
+    nextClientId_(1),
+    nextWaiterId_(1),
+    alive_(std::make_shared<bool>(true)) {
+
+    std::weak_ptr<bool> alive(alive_);
+    sweepTimer_ = loop_->runEvery(kSweepIntervalSeconds, [this, alive]() {
+        if(!alive.expired())
+            sweep();
+    });
+    LOG_DEBUG("%s:%s:%d => UpstreamPool=%s to %s create.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), serverAddr_.toIpPort().c_str());
+}
+
+// pending acquires are dropped without a callback. idle connections are closed, leased ones stay with
+// their holders and are closed when those let go of them
+UpstreamPool::~UpstreamPool() {
+    alive_.reset();
+    loop_->cancel(sweepTimer_);
+    for(Waiter &waiter: waiters_)
+        loop_->cancel(waiter.timer);
+    waiters_.clear();
+    idle_.clear();
+    connections_.clear();
+    connecting_.clear();
+    LOG_DEBUG("%s:%s:%d => UpstreamPool=%s destroy.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str());
+}
+
+void UpstreamPool::setMessageCallback(const MessageCallback &cb) {
+    messageCallback_ = cb;
+}
+
+void UpstreamPool::setLeaseLostCallback(const ConnectionCallback &cb) {
+    leaseLostCallback_ = cb;
+}
+
+void UpstreamPool::setMaxIdle(size_t n) {
+    maxIdle_ = n;
+    while(idle_.size() > maxIdle_) {
+        TcpConnectionPtr conn = idle_.front();
+        evict(conn, connections_[conn.get()]);
+    }
+}
+
+void UpstreamPool::setMinIdle(size_t n) {
+    minIdle_ = n;
+    replenish();
+}
+
+void UpstreamPool::setIdleTimeout(double seconds) {
+    idleTimeout_ = seconds;
+}
+
+void UpstreamPool::setAcquireTimeout(double seconds) {
+    acquireTimeout_ = seconds;
+}
+
+void UpstreamPool::acquire(AcquireCallback cb) {
+    // newest first: the connection least likely to have been timed out by the upstream
+    if(!idle_.empty()) {
+        TcpConnectionPtr conn = idle_.back();
+        idle_.pop_back();
+        lease(conn, connections_[conn.get()], cb);
+        return;
+    }
+
+    uint64_t id = nextWaiterId_++;
+    std::weak_ptr<bool> alive(alive_);
+    TimerId timer = loop_->runAfter(acquireTimeout_, [this, alive, id]() {
+        if(!alive.expired())
+            expireWaiter(id);
+    });
+    waiters_.push_back(Waiter{id, std::move(cb), timer});
+
+    // one new connection per waiter beyond the ones already on their way
+    if(connecting_.size() < waiters_.size())
+        openConnection();
+}
+
+void UpstreamPool::release(const TcpConnectionPtr &conn, bool reusable) {
+    auto it = connections_.find(conn.get());
+    if(it == connections_.end() || it->second.state != kLeased)
+        return;
+
+    Entry &entry = it->second;
+    if(!reusable || !conn->connected()) {
+        evict(conn, entry);
+        return;
+    }
+    if(handOffToWaiter(conn, entry))
+        return;
+    makeIdle(conn, entry);
+}
+
+size_t UpstreamPool::idleCount() const {
+    return idle_.size();
+}
+
+size_t UpstreamPool::leasedCount() const {
+    return std::count_if(connections_.begin(), connections_.end(), [](const std::pair<TcpConnection* const, Entry> &p) {
+        return p.second.state == kLeased;
+    });
+}
+
+size_t UpstreamPool::connectingCount() const {
+    return connecting_.size();
+}
+
+void UpstreamPool::openConnection() {
+    char buf[32] = {0};
+    snprintf(buf, sizeof buf, "-%d", nextClientId_++);
+    std::shared_ptr<TcpClient> client = std::make_shared<TcpClient>(loop_, serverAddr_, name_ + buf);
+    TcpClient *rawClient = client.get();
+
+    // the connections can outlive the pool, so every callback checks it is still there
+    std::weak_ptr<bool> alive(alive_);
+    client->setConnectionCallback([this, alive, rawClient](const TcpConnectionPtr &conn) {
+        if(!alive.expired())
+            onConnection(rawClient, conn);
+    });
+    client->setMessageCallback([this, alive](const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+        if(!alive.expired())
+            onMessage(conn, buf, receiveTime);
+        else
+            buf->retrieveAll();
+    });
+    client->setConnectFailedCallback([this, alive, rawClient]() {
+        if(!alive.expired())
+            onConnectFailed(rawClient);
+    });
+    client->setMaxConnectRetries(kConnectRetries);
+
+    connecting_[rawClient] = client;
+    client->connect();
+}
+
+void UpstreamPool::onConnection(TcpClient *client, const TcpConnectionPtr &conn) {
+    if(conn->connected()) {
+        auto cit = connecting_.find(client);
+        if(cit == connecting_.end()) {
+            conn->forceClose();
+            return;
+        }
+        Entry &entry = connections_[conn.get()];
+        entry.client = cit->second;
+        connecting_.erase(cit);
+
+        if(!handOffToWaiter(conn, entry))
+            makeIdle(conn, entry);
+        return;
+    }
+
+    auto it = connections_.find(conn.get());
+    if(it == connections_.end())
+        return;
+
+    State state = it->second.state;
+    if(state == kIdle)
+        removeIdle(conn.get());
+    // we are inside the client's close handling, let that return before the client goes
+    std::shared_ptr<TcpClient> doomed = std::move(it->second.client);
+    loop_->queueInLoop([doomed]() {});
+    connections_.erase(it);
+
+    if(state == kLeased && leaseLostCallback_)
+        leaseLostCallback_(conn);
+    replenish();
+}
+
+void UpstreamPool::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime) {
+    auto it = connections_.find(conn.get());
+    if(it != connections_.end() && it->second.state == kLeased) {
+        if(messageCallback_)
+            messageCallback_(conn, buf, receiveTime);
+        else
+            buf->retrieveAll();
+        return;
+    }
+
+    // nobody asked for these bytes, the connection is out of step with the upstream
+    LOG_ERROR("%s:%s:%d => UpstreamPool=%s unexpected %zu bytes on idle connection %s, evict.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), buf->readableBytes(), conn->name().c_str());
+    buf->retrieveAll();
+    if(it != connections_.end())
+        evict(conn, it->second);
+}
+
+void UpstreamPool::onConnectFailed(TcpClient *client) {
+    auto it = connecting_.find(client);
+    if(it == connecting_.end())
+        return;
+
+    LOG_ERROR("%s:%s:%d => UpstreamPool=%s connect to %s fail.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), serverAddr_.toIpPort().c_str());
+    // called from inside the client's connector
+    std::shared_ptr<TcpClient> doomed = std::move(it->second);
+    loop_->queueInLoop([doomed]() {});
+    connecting_.erase(it);
+
+    // the upstream is unreachable right now, fail the oldest waiter instead of letting it run into the timeout
+    if(waiters_.size() > connecting_.size()) {
+        Waiter waiter = std::move(waiters_.front());
+        waiters_.pop_front();
+        loop_->cancel(waiter.timer);
+        waiter.callback(nullptr);
+    }
+    replenish();
+}
+
+void UpstreamPool::makeIdle(const TcpConnectionPtr &conn, Entry &entry) {
+    entry.state = kIdle;
+    entry.idleSince = Timestamp::monotonicNow();
+    idle_.push_back(conn);
+    while(idle_.size() > maxIdle_) {
+        TcpConnectionPtr oldest = idle_.front();
+        evict(oldest, connections_[oldest.get()]);
+    }
+}
+
+void UpstreamPool::lease(const TcpConnectionPtr &conn, Entry &entry, const AcquireCallback &cb) {
+    entry.state = kLeased;
+    cb(conn);
+    replenish();
+}
+
+bool UpstreamPool::handOffToWaiter(const TcpConnectionPtr &conn, Entry &entry) {
+    if(waiters_.empty())
+        return false;
+
+    Waiter waiter = std::move(waiters_.front());
+    waiters_.pop_front();
+    loop_->cancel(waiter.timer);
+    lease(conn, entry, waiter.callback);
+    return true;
+}
+
+// the entry goes away when the close comes back through onConnection
+void UpstreamPool::evict(const TcpConnectionPtr &conn, Entry &entry) {
+    if(entry.state == kIdle)
+        removeIdle(conn.get());
+    entry.state = kClosing;
+    conn->forceClose();
+}
+
+void UpstreamPool::removeIdle(TcpConnection *conn) {
+    auto it = std::find_if(idle_.begin(), idle_.end(), [conn](const TcpConnectionPtr &c) { return c.get() == conn; });
+    if(it != idle_.end())
+        idle_.erase(it);
+}
+
+void UpstreamPool::expireWaiter(uint64_t id) {
+    auto it = std::find_if(waiters_.begin(), waiters_.end(), [id](const Waiter &w) { return w.id == id; });
+    if(it == waiters_.end())
+        return;
+
+    AcquireCallback cb = std::move(it->callback);
+    waiters_.erase(it);
+    LOG_ERROR("%s:%s:%d => UpstreamPool=%s acquire timed out after %.3f s.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), acquireTimeout_);
+    cb(nullptr);
+}
+
+void UpstreamPool::sweep() {
+    Timestamp deadline = addTime(Timestamp::monotonicNow(), -idleTimeout_);
+    // idle_ is ordered by idleSince, the oldest first
+    while(!idle_.empty()) {
+        TcpConnectionPtr conn = idle_.front();
+        Entry &entry = connections_[conn.get()];
+        if(deadline < entry.idleSince)
+            break;
+        LOG_DEBUG("%s:%s:%d => UpstreamPool=%s evict idle connection %s.", __FILENAME__, __FUNCTION__, __LINE__, name_.c_str(), conn->name().c_str());
+        evict(conn, entry);
+    }
+    replenish();
+}
+
+void UpstreamPool::replenish() {
+    while(idle_.size() + connecting_.size() < minIdle_)
+        openConnection();
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "Callbacks.h"
+#include "InetAddress.h"
+#include "noncopyable.h"
+#include "TimerId.h"
+#include "Timestamp.h"
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class EventLoop;
+class TcpClient;
+
+// keep-alive connections to one upstream address, owned by and used from a single EventLoop, so a request
+// takes an established connection instead of paying for a handshake. not thread safe: make one pool per
+// io loop and call it from that loop's thread only.
+//
+// a connection is either connecting, idle in the pool, or leased to a caller who hands it back with
+// release(). idle connections are reused newest first and evicted when they have been idle longer than
+// the idle timeout, when more than maxIdle would be kept, or when they fail a health check: data arriving
+// or the peer closing while nobody holds the connection means it is out of step with the upstream.
+// with setMinIdle the pool opens connections ahead of demand and tops them up as they are leased or evicted.
+class UpstreamPool: noncopyable {
+public:
+    // gets nullptr when no connection could be had within the acquire timeout
+    using AcquireCallback = std::function<void(const TcpConnectionPtr&)>;
+
+    UpstreamPool(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    ~UpstreamPool();
+
+    // input on leased connections, the same as a TcpClient message callback
+    void setMessageCallback(const MessageCallback &cb);
+    // a leased connection went down before it was released
+    void setLeaseLostCallback(const ConnectionCallback &cb);
+
+    void setMaxIdle(size_t n);
+    // connections kept ready, connecting ones included. opens them right away
+    void setMinIdle(size_t n);
+    void setIdleTimeout(double seconds);
+    void setAcquireTimeout(double seconds);
+
+    // calls back inline with an idle connection when there is one, otherwise once a new one is up
+    void acquire(AcquireCallback cb);
+    // hands a leased connection back. with reusable=false it is closed instead, e.g. after a protocol error
+    void release(const TcpConnectionPtr &conn, bool reusable = true);
+
+    size_t idleCount() const;
+    size_t leasedCount() const;
+    size_t connectingCount() const;
+
+public:
+    static const size_t kDefaultMaxIdle = 16;
+    static constexpr double kDefaultIdleTimeout = 60.0;
+    static constexpr double kDefaultAcquireTimeout = 3.0;
+    // connect attempts per new connection before it counts as failed
+    static const int kConnectRetries = 2;
+
+private:
+    enum State {kIdle, kLeased, kClosing};
+
+    struct Entry {
+        std::shared_ptr<TcpClient> client;
+        State state = kIdle;
+        Timestamp idleSince;
+    };
+
+    struct Waiter {
+        uint64_t id;
+        AcquireCallback callback;
+        TimerId timer;
+    };
+
+    void openConnection();
+    void onConnection(TcpClient *client, const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    void onConnectFailed(TcpClient *client);
+    void makeIdle(const TcpConnectionPtr &conn, Entry &entry);
+    void lease(const TcpConnectionPtr &conn, Entry &entry, const AcquireCallback &cb);
+    bool handOffToWaiter(const TcpConnectionPtr &conn, Entry &entry);
+    void evict(const TcpConnectionPtr &conn, Entry &entry);
+    void removeIdle(TcpConnection *conn);
+    void expireWaiter(uint64_t id);
+    void sweep();
+    void replenish();
+
+private:
+    EventLoop *loop_;
+    const InetAddress serverAddr_;
+    const std::string name_;
+    MessageCallback messageCallback_;
+    ConnectionCallback leaseLostCallback_;
+    size_t maxIdle_;
+    size_t minIdle_;
+    double idleTimeout_;
+    double acquireTimeout_;
+    int nextClientId_;
+    uint64_t nextWaiterId_;
+
+    // clients that have not connected yet, by client
+    std::unordered_map<TcpClient*, std::shared_ptr<TcpClient>> connecting_;
+    // established connections, by connection
+    std::unordered_map<TcpConnection*, Entry> connections_;
+    // idle connections, most recently released last
+    std::vector<TcpConnectionPtr> idle_;
+    std::deque<Waiter> waiters_;
+    TimerId sweepTimer_;
+    // lets callbacks already queued in the loop notice the pool is gone
+    std::shared_ptr<bool> alive_;
+};
@@ -0,0 +1,526 @@
+#include "UringPoller.h"
+#include "Buffer.h"
+#include "Channel.h"
+#include "Logger.h"
+#include "Timestamp.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+
+const int kNew = -1;
+const int kAdded = 1;
+const int kDeleted = 2;
+
+// completions of POLL_REMOVE and ASYNC_CANCEL requests carry this and are skipped
+static const uint64_t kIgnoreUserData = ~0ULL;
+// reads and writes of completion mode carry this and their slot. poll user_data never sets these bits,
+// it has the fd in the upper half
+static const uint64_t kIoUserData = 1ULL << 63;
+// the poll linked in front of a request that hit EAGAIN, its completion is skipped
+static const uint64_t kIoPollUserData = 1ULL << 62;
+
+const size_t UringPoller::kIoBufferSize;
+const int UringPoller::kIoBuffers;
+
+static int uringSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+static int uringRegister(int fd, unsigned opcode, const void *arg, unsigned nrArgs) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+static uint64_t encodeUserData(int fd, uint32_t generation) {
+    return (static_cast<uint64_t>(fd) << 32) | generation;
+}
+
+bool UringPoller::supported() {
+    static const bool supported = []() {
+        io_uring_params params;
+        memset(&params, 0, sizeof params);
+        int fd = uringSetup(2, &params);
+        if(fd < 0)
+            return false;
+        close(fd);
+        return (params.features & IORING_FEAT_EXT_ARG) != 0;
+    }();
+    return supported;
+}
+
+UringPoller::UringPoller(EventLoop *loop, bool completionIo):
+    Poller(loop),
+    ringFd_(-1),
+    features_(0),
+    sqRing_(nullptr),
+    sqRingSize_(0),
+    cqRing_(nullptr),
+    cqRingSize_(0),
+    sqes_(nullptr),
+    sqesSize_(0),
+    toSubmit_(0),
+    completionIo_(completionIo),
+    ioBuffers_(nullptr) {
+
+    io_uring_params params;
+    memset(&params, 0, sizeof params);
+    ringFd_ = uringSetup(kRingEntries, &params);
+    if(ringFd_ < 0)
+        LOG_FATAL("%s:%s:%d => io_uring fd create fail, exit, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, errno);
+    features_ = params.features;
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if(features_ & IORING_FEAT_SINGLE_MMAP)
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if(sqRing_ == MAP_FAILED)
+        LOG_FATAL("%s:%s:%d => io_uring sq ring map fail, exit, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, errno);
+    if(features_ & IORING_FEAT_SINGLE_MMAP)
+        cqRing_ = sqRing_;
+    else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if(cqRing_ == MAP_FAILED)
+            LOG_FATAL("%s:%s:%d => io_uring cq ring map fail, exit, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, errno);
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES));
+    if(sqes_ == MAP_FAILED)
+        LOG_FATAL("%s:%s:%d => io_uring sqes map fail, exit, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, errno);
+
+    char *sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    if(completionIo_)
+        registerIoBuffers();
+}
+
+// closing the ring cancels what is still in flight, the kernel keeps the registered pages until then
+UringPoller::~UringPoller() {
+    munmap(sqes_, sqesSize_);
+    if(cqRing_ != sqRing_)
+        munmap(cqRing_, cqRingSize_);
+    munmap(sqRing_, sqRingSize_);
+    close(ringFd_);
+    if(ioBuffers_)
+        munmap(ioBuffers_, kIoBuffers * kIoBufferSize);
+}
+
+Timestamp UringPoller::poll(int timeoutMs, ChannelList *activeChannels) {
+    LOG_DEBUG("%s:%s:%d => io_uring fd=%d will wait, total fd count that be listend is %lu.", __FILENAME__, __FUNCTION__, __LINE__, ringFd_, numChannels());
+
+    for(int fd: rearm_) {
+        PollState &state = states_[fd];
+        state.queuedRearm = false;
+        if(state.channel && !state.armed && state.channel->index() == kAdded && !state.channel->isNoneEvent())
+            arm(fd, state);
+    }
+    rearm_.clear();
+
+    submitAndWait(timeoutMs);
+    Timestamp now(Timestamp::now());
+    reapCompletions(activeChannels);
+    return now;
+}
+
+void UringPoller::updateChannel(Channel *channel) {
+    const int index = channel->index();
+    const int fd = channel->fd();
+    LOG_DEBUG("%s:%s:%d => socket fd=%d's channel will update event, events=%d, index=%d.", __FILENAME__, __FUNCTION__, __LINE__, fd, channel->events(), index);
+
+    PollState &state = stateOf(fd);
+    if(index == kNew || index == kDeleted) {
+        if(index == kNew)
+            addChannel(channel);
+        state.channel = channel;
+        channel->set_index(kAdded);
+        if(!channel->isNoneEvent())
+            arm(fd, state);
+    }
+    else if(channel->isNoneEvent()) {
+        disarm(fd, state);
+        channel->set_index(kDeleted);
+    }
+    else if(!state.armed || state.armedEvents != static_cast<uint32_t>(channel->pollEvents())) {
+        disarm(fd, state);
+        arm(fd, state);
+    }
+}
+
+void UringPoller::removeChannel(Channel *channel) {
+    const int fd = channel->fd();
+    eraseChannel(fd);
+
+    LOG_DEBUG("%s:%s:%d => socket fd=%d's channel will remove.", __FILENAME__, __FUNCTION__, __LINE__, fd);
+
+    PollState &state = stateOf(fd);
+    disarm(fd, state);
+    detachIo(state);
+    // whatever is still in flight for this fd belongs to the old channel
+    state.generation++;
+    state.channel = nullptr;
+    channel->set_index(kNew);
+}
+
+bool UringPoller::edgeTriggeredSupported() const {
+    return true;
+}
+
+bool UringPoller::attachIoBuffers(Channel *channel) {
+    const int fd = channel->fd();
+    PollState &state = stateOf(fd);
+    if(state.readSlot >= 0)
+        return true;
+    if(!completionIo_ || freeSlots_.size() < 2)
+        return false;
+
+    // registered like an added channel that is not polled for anything
+    const int index = channel->index();
+    if(index == kNew || index == kDeleted) {
+        if(index == kNew)
+            addChannel(channel);
+        state.channel = channel;
+        channel->set_index(kAdded);
+    }
+
+    state.readSlot = freeSlots_.back();
+    freeSlots_.pop_back();
+    state.writeSlot = freeSlots_.back();
+    freeSlots_.pop_back();
+    slots_[state.readSlot] = IoSlot{channel, fd, false};
+    slots_[state.writeSlot] = IoSlot{channel, fd, true};
+    return true;
+}
+
+bool UringPoller::startRead(Channel *channel) {
+    PollState &state = stateOf(channel->fd());
+    if(state.readSlot < 0)
+        return false;
+    IoSlot &slot = slots_[state.readSlot];
+    if(slot.inFlight || slot.finished)
+        return false;
+
+    submitIo(state.readSlot, false);
+    return true;
+}
+
+ssize_t UringPoller::finishRead(Channel *channel, Buffer *buf) {
+    PollState &state = stateOf(channel->fd());
+    if(state.readSlot < 0 || !slots_[state.readSlot].finished)
+        return -EAGAIN;
+
+    IoSlot &slot = slots_[state.readSlot];
+    slot.finished = false;
+    if(slot.result > 0)
+        buf->append(slotData(state.readSlot), slot.result);
+    return slot.result;
+}
+
+size_t UringPoller::startWrite(Channel *channel, const iovec *iov, int iovcnt) {
+    PollState &state = stateOf(channel->fd());
+    if(state.writeSlot < 0)
+        return 0;
+    IoSlot &slot = slots_[state.writeSlot];
+    if(slot.inFlight || slot.finished)
+        return 0;
+
+    char *data = slotData(state.writeSlot);
+    size_t length = 0;
+    for(int i = 0; i < iovcnt && length < kIoBufferSize; i++) {
+        size_t n = std::min(iov[i].iov_len, kIoBufferSize - length);
+        memcpy(data + length, iov[i].iov_base, n);
+        length += n;
+    }
+    if(length == 0)
+        return 0;
+
+    slot.length = length;
+    slot.offset = 0;
+    submitIo(state.writeSlot, false);
+    return length;
+}
+
+ssize_t UringPoller::finishWrite(Channel *channel) {
+    PollState &state = stateOf(channel->fd());
+    if(state.writeSlot < 0 || !slots_[state.writeSlot].finished)
+        return -EAGAIN;
+
+    IoSlot &slot = slots_[state.writeSlot];
+    slot.finished = false;
+    return slot.result;
+}
+
+UringPoller::PollState& UringPoller::stateOf(int fd) {
+    if(static_cast<size_t>(fd) >= states_.size())
+        states_.resize(std::max(static_cast<size_t>(fd) + 1, states_.size() * 2));
+    return states_[fd];
+}
+
+void UringPoller::arm(int fd, PollState &state) {
+    const uint32_t events = static_cast<uint32_t>(state.channel->pollEvents());
+    const bool edgeTriggered = (events & EPOLLET) != 0;
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    // one-shot unless edge-triggered, a one-shot poll re-armed on a still-ready fd completes at once
+    sqe->len = edgeTriggered ? IORING_POLL_ADD_MULTI : 0;
+    sqe->user_data = encodeUserData(fd, state.generation);
+
+    state.armed = true;
+    state.armedEvents = events;
+}
+
+void UringPoller::disarm(int fd, PollState &state) {
+    if(!state.armed)
+        return;
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = encodeUserData(fd, state.generation);
+    sqe->user_data = kIgnoreUserData;
+
+    // the cancelled poll completes with -ECANCELED under the old generation and is dropped
+    state.generation++;
+    state.armed = false;
+}
+
+void UringPoller::activate(PollState &state, uint32_t revents, ChannelList *activeChannels) {
+    state.revents |= revents;
+    if(!state.active) {
+        state.active = true;
+        activeChannels->push_back(state.channel);
+    }
+}
+
+// one anonymous mapping registered as a single fixed buffer, the slots are slices of it
+void UringPoller::registerIoBuffers() {
+    const size_t size = kIoBuffers * kIoBufferSize;
+    void *buffers = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(buffers == MAP_FAILED) {
+        LOG_ERROR("%s:%s:%d => io_uring fd=%d io buffers map fail, stay readiness only, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, ringFd_, errno);
+        completionIo_ = false;
+        return;
+    }
+
+    iovec iov;
+    iov.iov_base = buffers;
+    iov.iov_len = size;
+    if(uringRegister(ringFd_, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+        LOG_ERROR("%s:%s:%d => io_uring fd=%d io buffers register fail, stay readiness only, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, ringFd_, errno);
+        munmap(buffers, size);
+        completionIo_ = false;
+        return;
+    }
+
+    ioBuffers_ = static_cast<char*>(buffers);
+    slots_.resize(kIoBuffers);
+    for(int slot = kIoBuffers - 1; slot >= 0; slot--) {
+        freeSlots_.push_back(slot);
+    }
+}
+
+char* UringPoller::slotData(int slot) {
+    return ioBuffers_ + static_cast<size_t>(slot) * kIoBufferSize;
+}
+
+void UringPoller::submitIo(int slot, bool pollFirst) {
+    IoSlot &io = slots_[slot];
+    io_uring_sqe *sqe;
+    if(pollFirst) {
+        sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = io.fd;
+        sqe->poll32_events = io.write ? EPOLLOUT : EPOLLIN;
+        sqe->flags = IOSQE_IO_LINK;
+        sqe->user_data = kIoPollUserData | static_cast<uint64_t>(slot);
+    }
+
+    sqe = getSqe();
+    sqe->opcode = io.write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->fd = io.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(slotData(slot) + io.offset);
+    sqe->len = static_cast<uint32_t>(io.write ? io.length - io.offset : kIoBufferSize);
+    sqe->buf_index = 0;
+    sqe->user_data = kIoUserData | static_cast<uint64_t>(slot);
+    io.inFlight = true;
+}
+
+void UringPoller::cancel(uint64_t userData) {
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = userData;
+    sqe->user_data = kIgnoreUserData;
+}
+
+void UringPoller::completeIo(int slot, int res, ChannelList *activeChannels) {
+    IoSlot &io = slots_[slot];
+    io.inFlight = false;
+    if(io.channel == nullptr) {
+        freeSlots_.push_back(slot);
+        return;
+    }
+
+    if(res == -EAGAIN || res == -EINTR) {
+        submitIo(slot, res == -EAGAIN);
+        return;
+    }
+    if(io.write && res > 0 && io.offset + res < io.length) {
+        io.offset += res;
+        submitIo(slot, false);
+        return;
+    }
+
+    io.finished = true;
+    io.result = io.write && res > 0 ? static_cast<int>(io.length) : res;
+    activate(states_[io.fd], io.write ? EPOLLOUT : EPOLLIN, activeChannels);
+}
+
+// requests still in flight are cancelled, their completions free the slots
+void UringPoller::detachIo(PollState &state) {
+    for(int slot: {state.readSlot, state.writeSlot}) {
+        if(slot < 0)
+            continue;
+        IoSlot &io = slots_[slot];
+        io.channel = nullptr;
+        io.finished = false;
+        if(io.inFlight) {
+            cancel(kIoPollUserData | static_cast<uint64_t>(slot));
+            cancel(kIoUserData | static_cast<uint64_t>(slot));
+        }
+        else
+            freeSlots_.push_back(slot);
+    }
+    state.readSlot = -1;
+    state.writeSlot = -1;
+}
+
+// the tail is published straight away. without SQPOLL the kernel only reads the ring inside
+// io_uring_enter, and every caller fills its entry before the next one
+io_uring_sqe* UringPoller::getSqe() {
+    unsigned tail = *sqTail_;
+    if(tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+        int ret = uringEnter(ringFd_, toSubmit_, 0, 0, nullptr, 0);
+        if(ret > 0)
+            toSubmit_ -= std::min(static_cast<unsigned>(ret), toSubmit_);
+        if(tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+            LOG_FATAL("%s:%s:%d => io_uring fd=%d submission queue stays full, exit, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, ringFd_, errno);
+    }
+
+    unsigned index = tail & sqMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof *sqe);
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    toSubmit_++;
+    return sqe;
+}
+
+// one syscall submits every queued interest change and waits for the first completion
+void UringPoller::submitAndWait(int timeoutMs) {
+    unsigned flags = IORING_ENTER_GETEVENTS;
+    io_uring_getevents_arg arg;
+    __kernel_timespec ts;
+    const void *argp = nullptr;
+    size_t argSize = 0;
+    if(timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = (timeoutMs % 1000) * 1000000LL;
+        memset(&arg, 0, sizeof arg);
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        flags |= IORING_ENTER_EXT_ARG;
+        argp = &arg;
+        argSize = sizeof arg;
+    }
+
+    int ret = uringEnter(ringFd_, toSubmit_, 1, flags, argp, argSize);
+    int saveErrno = errno;
+    if(ret > 0)
+        toSubmit_ -= std::min(static_cast<unsigned>(ret), toSubmit_);
+    else if(ret < 0 && saveErrno != ETIME && saveErrno != EINTR) {
+        errno = saveErrno;
+        LOG_ERROR("%s:%s:%d => io_uring fd=%d's io_uring_enter() fail, do not get event, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, ringFd_, errno);
+    }
+}
+
+void UringPoller::reapCompletions(ChannelList *activeChannels) {
+    unsigned head = *cqHead_;
+    const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    const size_t firstActive = activeChannels->size();
+
+    for(; head != tail; head++) {
+        const io_uring_cqe *cqe = &cqes_[head & cqMask_];
+        if(cqe->user_data == kIgnoreUserData)
+            continue;
+        if(cqe->user_data & kIoUserData) {
+            completeIo(static_cast<int>(cqe->user_data & ~kIoUserData), cqe->res, activeChannels);
+            continue;
+        }
+        if(cqe->user_data & kIoPollUserData)
+            continue;
+
+        const int fd = static_cast<int>(cqe->user_data >> 32);
+        const uint32_t generation = static_cast<uint32_t>(cqe->user_data);
+        if(static_cast<size_t>(fd) >= states_.size())
+            continue;
+        PollState &state = states_[fd];
+        if(state.generation != generation || state.channel == nullptr)
+            continue;
+
+        uint32_t revents = 0;
+        if(cqe->res >= 0) {
+            revents = static_cast<uint32_t>(cqe->res);
+            if(!(cqe->flags & IORING_CQE_F_MORE)) {
+                state.armed = false;
+                if(!state.queuedRearm) {
+                    state.queuedRearm = true;
+                    rearm_.push_back(fd);
+                }
+            }
+        }
+        else {
+            // not re-armed, a poll that fails keeps failing. the next updateChannel arms it again
+            LOG_ERROR("%s:%s:%d => socket fd=%d's io_uring poll fail, errno=%d.", __FILENAME__, __FUNCTION__, __LINE__, fd, -cqe->res);
+            state.armed = false;
+            revents = EPOLLERR;
+        }
+
+        activate(state, revents, activeChannels);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    for(size_t i = firstActive; i < activeChannels->size(); i++) {
+        Channel *channel = (*activeChannels)[i];
+        PollState &state = states_[channel->fd()];
+        channel->set_revents(static_cast<int>(state.revents));
+        state.revents = 0;
+        state.active = false;
+    }
+}
+
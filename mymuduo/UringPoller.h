@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <linux/io_uring.h>
+#include <sys/types.h>
+#include <vector>
+
+
+class Channel;
+
+// readiness poller on io_uring, talking to the kernel through the raw syscalls.
+// each channel is an IORING_OP_POLL_ADD whose user_data carries fd and a generation, so completions
+// for a mask that has since been replaced, or an fd that has been reused, are told apart and dropped.
+// level-triggered channels use one-shot polls re-armed before every wait, which keeps epoll's
+// level-triggered behaviour. edge-triggered channels use a multishot poll with EPOLLET.
+// interest changes only queue SQEs, they all reach the kernel in the one io_uring_enter of the next poll().
+//
+// completion mode, experimental (see DefaultPoller.cpp), adds completion-based IO (see Poller::attachIoBuffers):
+// kIoBuffers slots of kIoBufferSize are registered with the kernel once, an attached channel gets one slot
+// to read into and one to write from, and its reads and writes are IORING_OP_READ_FIXED / WRITE_FIXED
+// requests on them, submitted with the interest changes. a read request waits for data in the kernel, so
+// readiness and the copy take one transition. short writes are resubmitted here and reported once the whole
+// slot is out. a request failing with EAGAIN, as older kernels do for nonblocking sockets, is resubmitted
+// behind a linked poll. the slots of a removed channel are cancelled and reused once their last completion
+// came back. when the buffers cannot be registered, e.g. over RLIMIT_MEMLOCK, the poller stays readiness only.
+class UringPoller: public Poller {
+public:
+    UringPoller(EventLoop *loop, bool completionIo = false);
+    ~UringPoller() override;
+
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannel(Channel *channel) override;
+    bool edgeTriggeredSupported() const override;
+
+    bool attachIoBuffers(Channel *channel) override;
+    bool startRead(Channel *channel) override;
+    ssize_t finishRead(Channel *channel, Buffer *buf) override;
+    size_t startWrite(Channel *channel, const iovec *iov, int iovcnt) override;
+    ssize_t finishWrite(Channel *channel) override;
+
+    // whether this kernel has io_uring with IORING_FEAT_EXT_ARG, probed once
+    static bool supported();
+
+private:
+    struct PollState {
+        Channel *channel = nullptr;
+        uint32_t generation = 0;
+        uint32_t armedEvents = 0;   // mask of the poll in flight, valid while armed
+        bool armed = false;
+        bool queuedRearm = false;
+        bool active = false;        // already in this round's activeChannels
+        uint32_t revents = 0;
+        int readSlot = -1;          // IoSlots of an attached channel
+        int writeSlot = -1;
+    };
+
+    struct IoSlot {
+        Channel *channel = nullptr; // null once detached, the last completion then frees the slot
+        int fd = -1;
+        bool write = false;
+        bool inFlight = false;
+        bool finished = false;      // result waiting for finishRead/finishWrite
+        int result = 0;
+        size_t length = 0;          // bytes taken by startWrite
+        size_t offset = 0;          // bytes of those already written
+    };
+
+    PollState& stateOf(int fd);
+    void arm(int fd, PollState &state);
+    void disarm(int fd, PollState &state);
+    void activate(PollState &state, uint32_t revents, ChannelList *activeChannels);
+
+    void registerIoBuffers();
+    char* slotData(int slot);
+    void submitIo(int slot, bool pollFirst);
+    void cancel(uint64_t userData);
+    void completeIo(int slot, int res, ChannelList *activeChannels);
+    void detachIo(PollState &state);
+
+    io_uring_sqe* getSqe();
+    void submitAndWait(int timeoutMs);
+    void reapCompletions(ChannelList *activeChannels);
+
+public:
+    // as much as a readiness read takes at once, so replies are not split into writes Nagle holds back.
+    // 8 MiB of locked memory per loop, 64 connections in completion mode, the rest use readiness
+    static const size_t kIoBufferSize = 64 * 1024;
+    static const int kIoBuffers = 128;
+
+private:
+    static const unsigned kRingEntries = 1024;
+
+    int ringFd_;
+    unsigned features_;
+
+    void *sqRing_;
+    size_t sqRingSize_;
+    void *cqRing_;
+    size_t cqRingSize_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    unsigned *sqArray_;
+    unsigned toSubmit_;
+
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe *cqes_;
+
+    // indexed by fd
+    std::vector<PollState> states_;
+    // level-triggered fds whose one-shot poll completed and must be re-armed before the next wait
+    std::vector<int> rearm_;
+
+    // completion mode, ioBuffers_ is registered as buffer 0 and carved into slots_
+    bool completionIo_;
+    char *ioBuffers_;
+    std::vector<IoSlot> slots_;
+    std::vector<int> freeSlots_;
+};
+
@@ -0,0 +1,81 @@
+// builds, runs and destroys an EventLoop on every registered Poller backend. covers channels removed
+// without ever being enabled and channels enabled and removed within one loop iteration, which is what
+// TimerQueue, Acceptor and Connector do while a loop comes and goes.
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "Poller.h"
+
+#include <cstdio>
+#include <string>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+
+
+static int failures = 0;
+
+static void check(bool ok, const std::string &poller, const char *what) {
+    if(!ok) {
+        fprintf(stderr, "%s: %s\n", poller.c_str(), what);
+        failures++;
+    }
+}
+
+static void run(const std::string &name) {
+    // construction and destruction alone, TimerQueue removes a channel that was never polled
+    {
+        EventLoop loop(name);
+    }
+
+    EventLoop loop(name);
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    {
+        Channel never(&loop, fd);
+        never.remove();
+    }
+
+    // enabled and removed before the loop polls once
+    {
+        Channel once(&loop, fd);
+        once.enableReading();
+        check(loop.hasChannel(&once), name, "enabled channel not registered");
+        once.disableAll();
+        once.remove();
+        check(!loop.hasChannel(&once), name, "removed channel still registered");
+    }
+
+    // a readable channel fires, then is removed from its own callback
+    Channel channel(&loop, fd);
+    bool fired = false;
+    channel.setReadCallback([&](Timestamp) {
+        uint64_t value;
+        read(fd, &value, sizeof value);
+        fired = true;
+        channel.disableAll();
+        channel.remove();
+        loop.quit();
+    });
+    channel.enableReading();
+    uint64_t one = 1;
+    write(fd, &one, sizeof one);
+    loop.runAfter(5.0, [&]() { loop.quit(); });
+    loop.loop();
+    check(fired, name, "read callback did not run");
+    check(!loop.hasChannel(&channel), name, "channel removed in its callback still registered");
+
+    close(fd);
+}
+
+int main() {
+    Logger::setLogLevel(Logger::ERROR);
+
+    std::vector<std::string> names = Poller::pollerNames();
+    for(const std::string &name: names) {
+        run(name);
+    }
+    if(failures == 0)
+        printf("%lu pollers OK\n", names.size());
+    return failures == 0 ? 0 : 1;
+}